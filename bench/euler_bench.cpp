@@ -0,0 +1,514 @@
+// Micro- and macro-benchmarks of the solver building blocks. The options are
+// listed in `usage` below (euler_bench --help).
+//
+// Every benchmark reports the median time per call, interior cells per second,
+// the nominal bytes moved per cell and the speedup over the first thread count.
+
+#include "AdaptiveMesh.h"
+#include "FlowState.h"
+#include "FluxSolver.h"
+#include "GridGenerator.h"
+#include "GridHandler.h"
+#include "Initialize.h"
+#include "Parallel.h"
+#include "Solver.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#ifndef EULER_DATA_DIR
+#define EULER_DATA_DIR "data"
+#endif
+
+namespace {
+
+struct Result {
+    std::string grid;
+    long long cells = 0;     // interior cells
+    std::string benchmark;
+    int threads = 1;
+    double seconds = 0.0;    // median time per call
+    double bytesPerCell = 0.0;
+    double speedup = 1.0;    // over the first thread count
+
+    double cellsPerSecond() const { return seconds > 0.0 ? cells / seconds : 0.0; }
+};
+
+struct Options {
+    std::vector<std::string> grids;
+    std::vector<long long> synthetic;
+    long long maxCells = 10000000;
+    std::vector<int> threads;
+    int reps = 5;
+    std::string json, csv, baseline;
+    double tolerance = 0.10;
+    bool validatePrecision = false;
+    bool help = false;
+};
+
+constexpr const char *usage = R"(usage: euler_bench [options]
+  --grid FILE       benchmark a text grid (repeatable; default: the shipped grids)
+  --synthetic N     add a synthetic wedge grid of about N cells
+                    (repeatable; default 1e4 1e5 1e6 1e7)
+  --max-cells N     skip synthetic grids larger than N cells
+  --threads LIST    comma-separated thread counts (default 1, 2, 4, ... up to the maximum)
+  --reps N          timed samples per benchmark, the median is reported (default 5)
+  --json FILE       write the results as JSON
+  --csv FILE        write the results as CSV
+  --baseline FILE   CSV of an earlier run; slower results are reported and the
+                    exit code is 3
+  --tolerance F     slowdown tolerated against the baseline (default 0.10)
+  --validate-precision
+                    only solve the wedge of the first grid in double and in
+                    mixed precision and compare the pressure fields; exit
+                    code 3 if they differ by more than 1e-4 (relative L2)
+  --help, -h        print these options and exit
+)";
+
+using Clock = std::chrono::steady_clock;
+
+// median seconds per call of body; setup runs untimed before every call, and
+// each sample repeats the call until it spans at least 20 ms
+double timeCall(int reps, const std::function<void()> &setup, const std::function<void()> &body) {
+    auto once = [&]() {
+        if (setup) {
+            setup();
+        }
+        const auto t0 = Clock::now();
+        body();
+        return std::chrono::duration<double>(Clock::now() - t0).count();
+    };
+
+    const double warm = once();
+    const int calls = std::clamp(static_cast<int>(0.02 / std::max(warm, 1e-9)), 1, 10000);
+    std::vector<double> samples;
+    for (int r = 0; r < reps; ++r) {
+        double total = 0.0;
+        for (int c = 0; c < calls; ++c) {
+            total += once();
+        }
+        samples.push_back(total / calls);
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+// Tecplot-style text grid of a generated 10 degree wedge (ramp from x = 10)
+// on a 30 x 10 domain with about `cells` cells, ten times as many in i as in
+// j. Reused if it already exists.
+std::string syntheticGrid(long long cells) {
+    const int nj = std::max(2, static_cast<int>(std::lround(std::sqrt(cells / 10.0))));
+    const int ni = std::max(2, static_cast<int>(std::lround(static_cast<double>(cells) / nj)));
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "euler_bench";
+    std::filesystem::create_directories(dir);
+    const std::filesystem::path file = dir / ("wedge_" + std::to_string(ni + 1) + "x" + std::to_string(nj + 1) + ".dat");
+    if (std::filesystem::exists(file)) {
+        return file.string();
+    }
+
+    // written under a temporary name so an interrupted run leaves no partial grid
+    GridSpec spec;
+    spec.ni = ni + 1;
+    spec.nj = nj + 1;
+    spec.length = 30.0;
+    spec.height = 10.0;
+    spec.corner = 10.0;
+    GridHandler grid;
+    const std::filesystem::path tmp = file.string() + ".tmp";
+    if (!generateGrid(spec, grid) || !grid.writeGridFile(tmp.string())) {
+        return file.string();
+    }
+    std::filesystem::rename(tmp, file);
+    return file.string();
+}
+
+// benchmarks of one grid at one thread count
+void benchGrid(const std::string &name, const std::string &file, int threads, int reps, std::vector<Result> &results) {
+    setThreadCount(threads);
+
+    GridHandler raw;
+    if (!raw.readGridFile(file)) {
+        return;
+    }
+    const long long cells = static_cast<long long>(raw.getNX() - 1) * (raw.getNY() - 1);
+    const double fileBytes = static_cast<double>(std::filesystem::file_size(file));
+    auto record = [&](const std::string &benchmark, double bytesPerCell, double seconds) {
+        Result r;
+        r.grid = name;
+        r.cells = cells;
+        r.benchmark = benchmark;
+        r.threads = threads;
+        r.seconds = seconds;
+        r.bytesPerCell = bytesPerCell;
+        results.push_back(r);
+        std::cout << std::left << std::setw(22) << name << std::right << std::setw(10) << cells
+                  << "  " << std::left << std::setw(26) << benchmark << std::right << std::setw(4) << threads
+                  << std::fixed << std::setprecision(4) << std::setw(12) << seconds * 1e3 << " ms"
+                  << std::setprecision(2) << std::setw(10) << r.cellsPerSecond() * 1e-6 << " Mcell/s"
+                  << std::setprecision(1) << std::setw(8) << bytesPerCell << " B/cell"
+                  << std::setprecision(2) << std::setw(8) << bytesPerCell * r.cellsPerSecond() * 1e-9 << " GB/s"
+                  << std::defaultfloat << "\n";
+    };
+
+    // grid preparation; nominal bytes count every double read or written once
+    {
+        GridHandler g;
+        record("readGridFile", fileBytes / cells + 16.0, timeCall(reps, nullptr, [&] { g.readGridFile(file); }));
+    }
+    {
+        GridHandler g;
+        record("haloCell", 48.0, timeCall(reps, [&] { g = raw; }, [&] { g.haloCell(); }));
+    }
+    GridHandler grid;
+    record("computeCellMetrics", 120.0, timeCall(reps, [&] { grid = raw; }, [&] { grid.computeCellMetrics(); }));
+    raw = GridHandler();
+
+    // state, boundary conditions and primitive fields
+    {
+        Initialize init(grid, 287.0, 1.4, 1005.0);
+        init.setInitialConditions(11664.0, 216.7, 3.0);
+        const double ghosts = 4.0 * (grid.getCellNX() + grid.getCellNY()); // two layers
+        record("applyBoundaryConditions", 64.0 * ghosts / cells,
+               timeCall(reps, nullptr, [&] { init.applyBoundaryConditions(); }));
+        record("computePrimitives", 72.0, timeCall(reps, nullptr, [&] { (void)init.computePrimitives(); }));
+
+        // flux kernel: Q, R and the unit normals and lengths of both face families
+        FluxSolver flux(grid, init.getGamma());
+        FlowState R(init.getState().getNI(), init.getState().getNJ());
+        record("computeResidual", 112.0, timeCall(reps, nullptr, [&] { flux.computeResidual(init.getState(), R); }));
+
+        // MUSCL: the primitive rows it reconstructs from stay in cache
+        FluxSolver muscl(grid, init.getGamma(), 256, 16, Precision::Double, Reconstruction::MUSCL);
+        record("computeResidual (MUSCL)", 112.0,
+               timeCall(reps, nullptr, [&] { muscl.computeResidual(init.getState(), R); }));
+    }
+
+    // whole pseudo-time steps
+    {
+        Initialize init(grid, 287.0, 1.4, 1005.0);
+        init.setInitialConditions(11664.0, 216.7, 3.0);
+        SolverOptions options;
+        Solver solver(grid, init, options);
+        record("iterate (forward Euler)", 352.0, timeCall(reps, nullptr, [&] { solver.iterate(); }));
+    }
+    {
+        // four residual sweeps and stage updates (Q_0 read and written), dt and norms once
+        Initialize init(grid, 287.0, 1.4, 1005.0);
+        init.setInitialConditions(11664.0, 216.7, 3.0);
+        SolverOptions options;
+        options.scheme = TimeScheme::RungeKutta;
+        options.stages = StageScheme::Upwind4;
+        options.cfl = 2.8;
+        Solver solver(grid, init, options);
+        record("iterate (Runge-Kutta, 4 stages)", 4.0 * 256.0 + 128.0, timeCall(reps, nullptr, [&] { solver.iterate(); }));
+    }
+    for (int steps : {1, 4}) {
+        // one pass per `steps` steps: Q, the metrics and 1 / V in, Q out
+        Initialize init(grid, 287.0, 1.4, 1005.0);
+        init.setInitialConditions(11664.0, 216.7, 3.0);
+        SolverOptions options;
+        options.fusedSweep = true;
+        options.temporalSteps = steps;
+        Solver solver(grid, init, options);
+        const std::string label = steps == 1 ? "iterate (fused)" : "iterate (fused, " + std::to_string(steps) + " steps)";
+        record(label, 120.0 / steps, timeCall(reps, nullptr, [&] { solver.iterate(); }) / steps);
+    }
+    {
+        // float state, residual, dt and metrics: half the bytes of the double step
+        Initialize init(grid, 287.0, 1.4, 1005.0);
+        init.setInitialConditions(11664.0, 216.7, 3.0);
+        SolverOptions options;
+        options.precision = Precision::Mixed;
+        Solver solver(grid, init, options);
+        record("iterate (mixed precision)", 176.0, timeCall(reps, nullptr, [&] { solver.iterate(); }));
+    }
+    if (cells <= 2000000) {
+        Initialize init(grid, 287.0, 1.4, 1005.0);
+        init.setInitialConditions(11664.0, 216.7, 3.0);
+        SolverOptions options;
+        options.scheme = TimeScheme::LUSGS;
+        options.cfl = 100.0;
+        Solver solver(grid, init, options);
+        record("iterate (LU-SGS)", 352.0 + 2.0 * 128.0 + 64.0, timeCall(reps, nullptr, [&] { solver.iterate(); }));
+    }
+    if (cells <= 200000) {
+        // composite step on the patches laid over the shocks after 200 steps:
+        // the base step, two steps per fine cell, restriction and interface fluxes
+        Initialize init(grid, 287.0, 1.4, 1005.0);
+        init.setInitialConditions(11664.0, 216.7, 3.0);
+        SolverOptions options;
+        options.printInterval = 0;
+        AdaptiveOptions amrOptions;
+        AdaptiveMesh amr(grid, init, options, amrOptions);
+        for (int n = 0; n < 200; ++n) {
+            amr.iterate();
+        }
+        amr.regrid();
+        const double fine = static_cast<double>(amr.getFineCells());
+        record("iterate (adaptive, ratio " + std::to_string(amrOptions.ratio) + ")",
+               352.0 * (cells + amrOptions.fineSteps * fine) / cells,
+               timeCall(reps, nullptr, [&] { amr.iterate(); }));
+    }
+}
+
+std::vector<std::string> split(const std::string &text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+bool parseArguments(int argc, char **argv, Options &opt) {
+    for (int a = 1; a < argc; ++a) {
+        const std::string arg = argv[a];
+        const bool hasValue = a + 1 < argc;
+        if (arg == "--grid" && hasValue) {
+            opt.grids.push_back(argv[++a]);
+        } else if (arg == "--synthetic" && hasValue) {
+            opt.synthetic.push_back(static_cast<long long>(std::stod(argv[++a])));
+        } else if (arg == "--max-cells" && hasValue) {
+            opt.maxCells = static_cast<long long>(std::stod(argv[++a]));
+        } else if (arg == "--threads" && hasValue) {
+            for (const std::string &t : split(argv[++a], ',')) {
+                opt.threads.push_back(std::max(std::stoi(t), 1));
+            }
+        } else if (arg == "--reps" && hasValue) {
+            opt.reps = std::max(std::stoi(argv[++a]), 1);
+        } else if (arg == "--json" && hasValue) {
+            opt.json = argv[++a];
+        } else if (arg == "--csv" && hasValue) {
+            opt.csv = argv[++a];
+        } else if (arg == "--baseline" && hasValue) {
+            opt.baseline = argv[++a];
+        } else if (arg == "--tolerance" && hasValue) {
+            opt.tolerance = std::stod(argv[++a]);
+        } else if (arg == "--validate-precision") {
+            opt.validatePrecision = true;
+        } else if (arg == "--help" || arg == "-h") {
+            opt.help = true;
+        } else {
+            std::cerr << "Unknown or incomplete argument: " << arg << "\n" << usage;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeJSON(const std::string &filename, const std::vector<Result> &results) {
+    std::ofstream out(filename, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    out << std::setprecision(9);
+    out << "{\n  \"format\": \"euler_bench\",\n  \"version\": 1,\n"
+        << "  \"simd\": \"" << FluxSolver::simdTarget() << "\",\n"
+        << "  \"max_threads\": " << getThreadCount() << ",\n  \"results\": [\n";
+    for (std::size_t n = 0; n < results.size(); ++n) {
+        const Result &r = results[n];
+        out << "    {\"grid\": \"" << r.grid << "\", \"cells\": " << r.cells
+            << ", \"benchmark\": \"" << r.benchmark << "\", \"threads\": " << r.threads
+            << ", \"seconds\": " << r.seconds << ", \"cells_per_s\": " << r.cellsPerSecond()
+            << ", \"bytes_per_cell\": " << r.bytesPerCell << ", \"speedup\": " << r.speedup << "}"
+            << (n + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+bool writeCSV(const std::string &filename, const std::vector<Result> &results) {
+    std::ofstream out(filename, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    out << std::setprecision(9);
+    out << "grid,cells,benchmark,threads,seconds,cells_per_s,bytes_per_cell,speedup\n";
+    for (const Result &r : results) {
+        out << r.grid << "," << r.cells << "," << r.benchmark << "," << r.threads << "," << r.seconds << ","
+            << r.cellsPerSecond() << "," << r.bytesPerCell << "," << r.speedup << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+// number of results more than tolerance slower than in the baseline CSV
+int compareBaseline(const std::string &filename, const std::vector<Result> &results, double tolerance) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return -1;
+    }
+    std::map<std::tuple<std::string, std::string, int>, double> before;
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line)) {
+        const std::vector<std::string> f = split(line, ',');
+        if (f.size() >= 5) {
+            before[{f[0], f[2], std::stoi(f[3])}] = std::stod(f[4]);
+        }
+    }
+
+    int regressions = 0;
+    for (const Result &r : results) {
+        const auto it = before.find({r.grid, r.benchmark, r.threads});
+        if (it == before.end() || it->second <= 0.0) {
+            continue;
+        }
+        const double ratio = r.seconds / it->second;
+        if (ratio > 1.0 + tolerance) {
+            ++regressions;
+            std::cout << "REGRESSION " << r.grid << " " << r.benchmark << " threads " << r.threads
+                      << ": " << std::fixed << std::setprecision(2) << ratio << "x slower"
+                      << std::defaultfloat << "\n";
+        }
+    }
+    return regressions;
+}
+
+// Solves the wedge in double and in mixed precision and compares the
+// pressure fields. Float storage stalls the residual a few decades above
+// double precision, so both runs stop at a loose relative residual.
+// Returns 0 if they agree, 3 if not, 1 on error.
+int validatePrecision(const std::string &file) {
+    GridHandler grid;
+    if (!grid.readGridFile(file)) {
+        return 1;
+    }
+    grid.computeCellMetrics();
+
+    auto solve = [&](Precision precision, Initialize &init) {
+        init.setInitialConditions(11664.0, 216.7, 3.0);
+        init.applyBoundaryConditions();
+        SolverOptions options;
+        options.precision = precision;
+        options.tolerance = 1e-5;
+        options.printInterval = 0;
+        Solver solver(grid, init, options);
+        const auto t0 = Clock::now();
+        const bool converged = solver.run();
+        std::cout << (precision == Precision::Mixed ? "mixed " : "double") << ": "
+                  << solver.getMonitor().getIterations() << " iterations, relative L2 "
+                  << solver.getMonitor().relativeL2() << ", "
+                  << std::chrono::duration<double>(Clock::now() - t0).count() << " s\n";
+        return converged;
+    };
+
+    Initialize reference(grid, 287.0, 1.4, 1005.0);
+    Initialize mixed(grid, 287.0, 1.4, 1005.0);
+    if (!solve(Precision::Double, reference) || !solve(Precision::Mixed, mixed)) {
+        std::cerr << "Precision validation: a run did not converge\n";
+        return 3;
+    }
+
+    reference.computePrimitives();
+    mixed.computePrimitives();
+    const auto P0 = reference.getPressure();
+    const auto P1 = mixed.getPressure();
+    double difference = 0.0, norm = 0.0, largest = 0.0;
+    for (int j = 1; j < P0.cols() - 1; ++j) {
+        for (int i = 1; i < P0.rows() - 1; ++i) {
+            const double d = P1(i, j) - P0(i, j);
+            difference += d * d;
+            norm += P0(i, j) * P0(i, j);
+            largest = std::max(largest, std::fabs(d) / P0(i, j));
+        }
+    }
+    const double relative = std::sqrt(difference / norm);
+    std::cout << "pressure difference: relative L2 " << relative << ", largest " << largest << "\n";
+    if (!(relative <= 1e-4)) {
+        std::cerr << "Precision validation failed: mixed precision pressure differs by " << relative << "\n";
+        return 3;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArguments(argc, argv, opt)) {
+        return 1;
+    }
+    if (opt.help) {
+        std::cout << usage;
+        return 0;
+    }
+    if (opt.grids.empty()) {
+        opt.grids = {std::string(EULER_DATA_DIR) + "/g321x033uf.dat", std::string(EULER_DATA_DIR) + "/g641x065uf.dat"};
+    }
+    if (opt.validatePrecision) {
+        return validatePrecision(opt.grids.front());
+    }
+    if (opt.synthetic.empty()) {
+        opt.synthetic = {10000, 100000, 1000000, 10000000};
+    }
+    if (opt.threads.empty()) {
+        const int maxThreads = getThreadCount();
+        for (int t = 1; t < maxThreads; t *= 2) {
+            opt.threads.push_back(t);
+        }
+        opt.threads.push_back(maxThreads);
+    }
+
+    // (label, file) of every grid to run
+    std::vector<std::pair<std::string, std::string>> grids;
+    for (const std::string &g : opt.grids) {
+        grids.emplace_back(std::filesystem::path(g).stem().string(), g);
+    }
+    for (long long cells : opt.synthetic) {
+        if (cells > opt.maxCells) {
+            continue;
+        }
+        grids.emplace_back("synthetic_" + std::to_string(cells), syntheticGrid(cells));
+    }
+
+    std::cout << "euler_bench: flux kernel " << FluxSolver::simdTarget()
+              << ", up to " << getThreadCount() << " threads\n";
+    std::vector<Result> results;
+    for (const auto &[name, file] : grids) {
+        const std::size_t first = results.size();
+        for (int t : opt.threads) {
+            benchGrid(name, file, t, opt.reps, results);
+        }
+        // speedup of every benchmark over its run at the first thread count
+        for (std::size_t n = first; n < results.size(); ++n) {
+            for (std::size_t m = first; m < results.size(); ++m) {
+                if (results[m].benchmark == results[n].benchmark && results[m].threads == opt.threads.front()) {
+                    results[n].speedup = results[m].seconds / results[n].seconds;
+                }
+            }
+        }
+    }
+
+    bool ok = true;
+    if (!opt.json.empty()) {
+        ok = writeJSON(opt.json, results) && ok;
+    }
+    if (!opt.csv.empty()) {
+        ok = writeCSV(opt.csv, results) && ok;
+    }
+    if (!opt.baseline.empty()) {
+        const int regressions = compareBaseline(opt.baseline, results, opt.tolerance);
+        if (regressions < 0) {
+            return 1;
+        }
+        if (regressions > 0) {
+            return 3;
+        }
+    }
+    return ok ? 0 : 1;
+}
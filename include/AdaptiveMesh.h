@@ -0,0 +1,148 @@
+#ifndef ADAPTIVEMESH_H
+#define ADAPTIVEMESH_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "BlockCoupling.h"
+#include "FlowState.h"
+#include "GridHandler.h"
+#include "Initialize.h"
+#include "Parallel.h"
+#include "ResidualMonitor.h"
+#include "Solver.h"
+
+// Adaptive refinement controls
+struct AdaptiveOptions {
+    int ratio = 2;             // fine cells per base cell in each direction
+    int blockSize = 4;         // base cells per side of a refinement block
+    double threshold = 0.05;   // pressure sensor that flags a cell (relative jump across it)
+    int buffer = 2;            // base cells flagged around every sensed one, so a moving shock stays inside
+    int regridInterval = 100;  // iterations between regrids
+    int keepRegrids = 3;       // regrids a refined block stays without being flagged (once coarsened and
+                               // flagged again it stays for good)
+    int fineSteps = 2;         // patch iterations per base iteration
+};
+
+// Block-structured adaptive mesh refinement for the steady solution: one level
+// of patches, each a box of base cells split ratio x ratio, laid over the
+// blocks of blockSize x blockSize base cells whose pressure sensor flags a
+// shock or an expansion fan. Every level is marched by its own Solver. Patch
+// ghosts are copied from the patch next to them or, on coarse-fine
+// interfaces, interpolated from the base level with limited slopes; patch
+// sides on the domain boundary keep the base BCs. Base cells under a patch
+// hold the volume average of its cells, and the base cells next to a patch
+// replace their fluxes through the interface by the sum of the fine ones (a
+// forcing term), so the composite solution is conservative once converged.
+// The patches are rebuilt every regridInterval iterations to follow the
+// shocks, keeping refined blocks for a few regrids (for good once they
+// come back) so the layout settles; the composite residual (uncovered base
+// cells and all fine cells) is what the convergence is judged on.
+class AdaptiveMesh {
+public:
+    // grid must already be halo-extended, init must hold the initial state.
+    // The levels run in double precision with separate passes.
+    AdaptiveMesh(const GridHandler &grid, Initialize &init,
+                 const SolverOptions &solverOptions,
+                 const AdaptiveOptions &options);
+    ~AdaptiveMesh();
+
+    AdaptiveMesh(const AdaptiveMesh &) = delete;
+    AdaptiveMesh &operator=(const AdaptiveMesh &) = delete;
+
+    // flag the base cells from the current state and rebuild the patches
+    // over the flagged blocks, carrying over the fine cells that stay
+    // refined; true if the patch layout changed
+    bool regrid();
+
+    // one composite step: base level with the interface fluxes corrected,
+    // fineSteps on every patch, restriction onto the covered base cells;
+    // returns the composite norms
+    const ResidualNorms &iterate();
+
+    // march until converged (with a layout that a last regrid keeps),
+    // stalled or maxIterations; true if converged. Solution files hold the
+    // base level (<prefix>_<iteration>) and every patch on its own grid
+    // (<prefix>_p<patch>_<iteration>), indexed by <prefix>_<iteration>.vtm
+    // for VTK. Checkpoints hold the base level only.
+    bool run();
+
+    // start from a checkpoint of the base level: the iteration count and
+    // residual history are restored, and the patches are rebuilt over it
+    // with their fine cells interpolated from the base cells, so the fine
+    // shocks re-converge from the patch averages
+    bool restart(const std::string &filename);
+
+    // getter methods
+    int getPatchCount() const { return static_cast<int>(patches.size()); }
+    // base cells covered by patch p
+    Tile getPatchBox(int p) const {
+        const Patch &patch = *patches[p];
+        return Tile{patch.iBegin, patch.iEnd, patch.jBegin, patch.jEnd};
+    }
+    const GridHandler &getPatchGrid(int p) const { return patches[p]->grid; }
+    const Initialize &getPatchState(int p) const { return *patches[p]->init; }
+    long long getBaseCells() const;
+    long long getFineCells() const;      // interior cells of all patches
+    long long getCompositeCells() const; // uncovered base cells and fine cells
+    const ResidualMonitor &getMonitor() const { return monitor; }
+
+private:
+    // ghost cell of a patch and where its value comes from
+    struct Ghost {
+        int i, j;                     // ghost cell of the patch
+        const FlowState *source;      // sibling patch state, nullptr = base level
+        int si, sj;                   // cell of the sibling, or base cell it lies in
+        double dx, dy;                // offset from that base cell's centre, in base cells
+    };
+
+    // base cell next to a patch whose interface flux is corrected
+    struct Interface {
+        int ci, cj;  // uncovered base cell
+        bool xiFace; // xi or eta face between it and the patch
+        int face;    // base face index (i for xi faces, j for eta faces)
+        int fine;    // patch face index on the same face line
+        int first;   // first patch row (xi) or column (eta) along the face
+        double sign; // +1 if the face is the base cell's +xi/+eta face
+    };
+
+    struct Patch : public BlockCoupling {
+        int iBegin = 0, iEnd = 0, jBegin = 0, jEnd = 0; // covered base cells
+        GridHandler grid;
+        std::unique_ptr<Initialize> init;
+        std::unique_ptr<Solver> solver;
+        std::unique_ptr<SolutionWriter> output; // with SolverOptions::output enabled
+        std::vector<Ghost> ghosts;
+        std::vector<Interface> interfaces;
+        const AdaptiveMesh *mesh = nullptr;
+
+        // ghosts are filled at once, nothing is in flight
+        void beginExchange(FlowState &Q) override { mesh->fillGhosts(*this, Q); }
+        void finishExchange(FlowState &) override { }
+        ResidualNorms reduceNorms(const ResidualNorms &sums, double cells) override;
+        double reduceMin(double value) override { return value; }
+    };
+
+    void fillGhosts(const Patch &patch, FlowState &Q) const;
+    void interpolate(int ci, int cj, double dx, double dy, double q[4]) const;
+    void flagCells(std::vector<unsigned char> &flags) const;
+    void linkPatches();
+    void applyFluxCorrection();
+    void restrictToBase();
+    const ResidualNorms &recordComposite();
+
+    const GridHandler &grid;
+    Initialize &init;
+    AdaptiveOptions options;
+    SolverOptions levelOptions;
+    std::unique_ptr<Solver> base;
+    std::vector<std::unique_ptr<Patch>> patches;
+    std::vector<int> owner;         // patch covering each base cell, -1 = none
+    std::vector<int> unflagged;     // regrids in a row a refined block went unflagged
+    std::vector<unsigned char> dropped; // block was refined once and coarsened again
+    FlowState correction;           // interface flux corrections, forcing of the base level
+    double jumpScale2[4];           // freestream eps2 floor of the interpolation slopes
+    ResidualMonitor monitor;
+};
+
+#endif  // ADAPTIVEMESH_H
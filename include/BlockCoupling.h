@@ -0,0 +1,26 @@
+#ifndef BLOCKCOUPLING_H
+#define BLOCKCOUPLING_H
+
+#include "FlowState.h"
+#include "ResidualMonitor.h"
+
+// Link between one block of a multi-block run and the rest of the domain. The
+// solver only sees this interface; MultiBlock implements it on top of MPI.
+class BlockCoupling {
+public:
+    virtual ~BlockCoupling() = default;
+
+    // start filling the InterBlock ghost cells of Q from the neighbours; the
+    // interior may be worked on until finishExchange() returns
+    virtual void beginExchange(FlowState &Q) = 0;
+    virtual void finishExchange(FlowState &Q) = 0;
+
+    // global norms from this block's sums (L2 = sum of R^2, Linf = max |R|)
+    // over its cells
+    virtual ResidualNorms reduceNorms(const ResidualNorms &sums, double cells) = 0;
+
+    // global minimum over all blocks
+    virtual double reduceMin(double value) = 0;
+};
+
+#endif  // BLOCKCOUPLING_H
@@ -0,0 +1,35 @@
+#ifndef BLOCKDECOMPOSITION_H
+#define BLOCKDECOMPOSITION_H
+
+#include <array>
+#include <vector>
+
+// One sub-block: interior cells [iBegin, iEnd) x [jBegin, jEnd) of the global
+// halo-extended cell grid and the block across each side, [WEST, EAST, SOUTH,
+// NORTH] (-1 = physical boundary).
+struct Block {
+    int iBegin, iEnd;
+    int jBegin, jEnd;
+    std::array<int, 4> neighbour;
+};
+
+// Splits the interior of an ni x nj halo-extended cell grid into a px x py
+// array of blocks of near-equal size. The factorization of the block count
+// is chosen to minimize the total length of the cuts (halo traffic).
+class BlockDecomposition {
+public:
+    BlockDecomposition();
+    BlockDecomposition(int ni, int nj, int blocks);
+
+    // getter methods
+    int getBlockCount() const { return static_cast<int>(blocks.size()); }
+    int getBlocksI() const { return blocksI; }
+    int getBlocksJ() const { return blocksJ; }
+    const Block &getBlock(int b) const { return blocks[b]; }
+
+private:
+    int blocksI, blocksJ; // blocks in i and j
+    std::vector<Block> blocks; // numbered i fastest
+};
+
+#endif  // BLOCKDECOMPOSITION_H
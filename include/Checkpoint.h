@@ -0,0 +1,77 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "FlowState.h"
+#include "GridHandler.h"
+#include "ResidualMonitor.h"
+#include "SnapshotQueue.h"
+
+// Binary checkpoint layout (native byte order, all blocks 8-byte aligned):
+//   CheckpointHeader
+//   nodeNX * nodeNY doubles of x, then of y (halo-extended nodes, column-major)
+//   historyLength ResidualNorms (L2[4], Linf[4])
+//   4 planes of ni * nj doubles (rho, rho*u, rho*v, rho*E), i fastest, no padding
+struct CheckpointHeader {
+    char magic[8];               // "EULCKPT"
+    std::uint32_t version;       // bumped when the layout changes
+    std::uint32_t byteOrder;     // 0x01020304 as written by the producer
+    std::int32_t nodeNX, nodeNY; // halo-extended node counts
+    std::int32_t ni, nj;         // cells including the halo layer
+    std::uint64_t gridHash;      // gridHash() of the grid the state lives on
+    std::int64_t iteration;      // iterations (or cycles) completed
+    std::int64_t historyLength;  // residual norms stored
+    double gamma;                // ratio of specific heats of the run
+};
+
+// FNV-1a hash of the node dimensions and coordinates
+std::uint64_t gridHash(const GridHandler &grid);
+
+// Writes checkpoints from a background thread (see SnapshotQueue), so the
+// solver never waits for the disk. Files are written to filename.tmp and
+// renamed, so a run killed mid-write leaves the previous checkpoint intact.
+class CheckpointWriter {
+public:
+    CheckpointWriter(const GridHandler &grid, const std::string &filename, double gamma);
+
+    // queue Q and the residual history after `iteration` steps
+    void submit(const FlowState &Q, int iteration, const std::vector<ResidualNorms> &history) {
+        queue.submit(Q, iteration, &history);
+    }
+
+    // block until every submitted snapshot is on disk; false if a write failed
+    bool wait() { return queue.wait(); }
+
+    // getter methods
+    const std::string &getFilename() const { return filename; }
+    int getWritten() const { return queue.getWritten(); } // checkpoints on disk, valid after wait()
+
+private:
+    bool writeSnapshot(const Snapshot &s) const;
+
+    std::string filename;
+    double gamma;
+    int nodeNX, nodeNY;
+    std::uint64_t hash;
+    std::vector<double> nodes; // x then y, copied once
+    SnapshotQueue queue;       // last, so it drains before the rest goes away
+};
+
+// What a checkpoint holds besides the state
+struct CheckpointInfo {
+    bool sameGrid = false;              // written on the grid it was read onto
+    int iteration = 0;                  // iterations (or cycles) completed
+    std::vector<ResidualNorms> history; // residual norms of the run that wrote it
+};
+
+// Restores Q from a checkpoint (memory-mapped). On the grid it was written on
+// (same gridHash) the state is copied exactly. On a different grid covering
+// the same domain (e.g. a refined one) the interior is interpolated
+// bilinearly in cell-index space. Halo cells are left for
+// applyBoundaryConditions().
+bool readCheckpoint(const std::string &filename, const GridHandler &grid,
+                    FlowState &Q, CheckpointInfo &info);
+
+#endif  // CHECKPOINT_H
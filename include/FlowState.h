@@ -0,0 +1,116 @@
+#ifndef FLOWSTATE_H
+#define FLOWSTATE_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Minimal allocator handing out cache-line aligned blocks so every padded row
+// of a FlowState starts on a SIMD boundary.
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(std::size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+    void deallocate(T *p, std::size_t) {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    // resize() default-initializes instead of zeroing, so the pages of a fresh
+    // block are first touched by whichever thread writes them first (NUMA)
+    template <typename U>
+    void construct(U *p) { ::new (static_cast<void *>(p)) U; }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args) { ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Storage precision of the state, metrics and residual in the explicit sweeps.
+// Mixed keeps them in float and does the flux sums, norms and updates in double.
+enum class Precision {
+    Double,
+    Mixed
+};
+
+// Structure-of-arrays storage for the four conserved variables on the cell grid
+// (halo layer included). Each variable is one contiguous plane with i running
+// fastest, matching the column-major Eigen layout, and every j-row padded to a
+// whole number of cache lines. Real is the storage type (double or float).
+//
+// Every plane also has room for a second ghost layer outside the grid's cells,
+// i = -1 and ni, j = -1 and nj, for the MUSCL stencils that reach two cells
+// across a boundary. Rows -1 and nj are extra rows of the plane; a row keeps
+// at least two values of padding, column ni being the first of them and
+// column -1 the last of the row below.
+template <typename Real>
+class BasicFlowState {
+public:
+    using value_type = Real;
+    static constexpr int NVAR = 4;
+    static constexpr int PAD = 64 / sizeof(Real); // values per 64-byte cache line
+
+    BasicFlowState();
+    BasicFlowState(int ni, int nj);
+
+    // (re)allocate for ni x nj cells, contents zeroed row by row in parallel so
+    // each row lands in the memory of the thread that sweeps it
+    void resize(int ni, int nj);
+    void setZero();
+
+    // copy the values of another state with identical dimensions, converting
+    // between precisions if needed
+    template <typename Other>
+    void copyFrom(const BasicFlowState<Other> &other);
+
+    // exchange storage with another state (double-buffered sweeps)
+    void swap(BasicFlowState &other) noexcept {
+        std::swap(ni, other.ni);
+        std::swap(nj, other.nj);
+        std::swap(stride, other.stride);
+        std::swap(planeSize, other.planeSize);
+        data.swap(other.data);
+    }
+
+    // getter methods
+    int getNI() const { return ni; }
+    int getNJ() const { return nj; }
+    int getStride() const { return stride; }
+    std::size_t getPlaneSize() const { return planeSize; }
+
+    // plane(k) points at cell (0, 0); j may be -1 to nj, i -1 to ni
+    Real *plane(int k) { return data.data() + k * planeSize + stride; }
+    const Real *plane(int k) const { return data.data() + k * planeSize + stride; }
+    Real *row(int k, int j) { return plane(k) + static_cast<std::ptrdiff_t>(j) * stride; }
+    const Real *row(int k, int j) const { return plane(k) + static_cast<std::ptrdiff_t>(j) * stride; }
+
+    Real &operator()(int k, int i, int j) { return row(k, j)[i]; }
+    Real operator()(int k, int i, int j) const { return row(k, j)[i]; }
+
+private:
+    int ni, nj;             // cells in i and j, including halos
+    int stride;             // padded row length, at least ni + 2
+    std::size_t planeSize;  // values per conserved variable, rows -1 and nj included
+    AlignedVector<Real> data;
+};
+
+using FlowState = BasicFlowState<double>;
+using FlowStateF = BasicFlowState<float>;
+
+#endif  // FLOWSTATE_H
@@ -0,0 +1,301 @@
+#ifndef FLUXSOLVER_H
+#define FLUXSOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "FlowState.h"
+#include "GridHandler.h"
+#include "Initialize.h"
+#include "Parallel.h"
+#include "ResidualMonitor.h"
+
+// Unit normals and lengths of one family of faces, stored on the same padded
+// (i, j) layout as FlowState so a row of faces lines up with a row of cells.
+template <typename Real>
+struct BasicFaceMetrics {
+    int stride = 0;
+    AlignedVector<Real> nx;  // unit normal, x-component
+    AlignedVector<Real> ny;  // unit normal, y-component
+    AlignedVector<Real> len; // face length (area per unit depth)
+
+    Real *rowNX(int j) { return nx.data() + static_cast<std::size_t>(j) * stride; }
+    Real *rowNY(int j) { return ny.data() + static_cast<std::size_t>(j) * stride; }
+    Real *rowLen(int j) { return len.data() + static_cast<std::size_t>(j) * stride; }
+    const Real *rowNX(int j) const { return nx.data() + static_cast<std::size_t>(j) * stride; }
+    const Real *rowNY(int j) const { return ny.data() + static_cast<std::size_t>(j) * stride; }
+    const Real *rowLen(int j) const { return len.data() + static_cast<std::size_t>(j) * stride; }
+};
+
+using FaceMetrics = BasicFaceMetrics<double>;
+using FaceMetricsF = BasicFaceMetrics<float>;
+
+// Face states of the residual sweeps
+enum class Reconstruction {
+    FirstOrder, // cell values (first-order upwind)
+    MUSCL       // limited linear reconstruction of rho, u, v, P (second order, two ghost layers)
+};
+
+// Slope limiters of the MUSCL reconstruction. Jumps of a few percent of the
+// freestream value are left nearly unlimited, so the residual converges with all three.
+enum class Limiter {
+    Minmod,    // most dissipative
+    VanAlbada, // smooth
+    VanLeer    // sharpest shocks
+};
+
+// Split flux terms shared by splitFlux and splitFluxPrimitive, from the
+// velocity, its square, the sound speed and the total enthalpy of the state.
+template <typename T>
+inline void addSplitFlux(double gamma, double sign,
+                         T rho, T u, T v, T q2, T a, T H,
+                         double nx, double ny, double len,
+                         T &f0, T &f1, T &f2, T &f3) {
+    using std::fabs;
+    const T Vn = u * nx + v * ny;
+
+    // split eigenvalues: lambda± = (lambda ± |lambda|) / 2
+    const T l1 = 0.5 * (Vn + sign * fabs(Vn));
+    const T l3 = 0.5 * ((Vn + a) + sign * fabs(Vn + a));
+    const T l4 = 0.5 * ((Vn - a) + sign * fabs(Vn - a));
+
+    const T s = 0.5 / gamma * len * rho;
+    const T w1 = 2.0 * (gamma - 1.0) * l1 * s;
+    const T w3 = l3 * s;
+    const T w4 = l4 * s;
+
+    f0 += w1 + w3 + w4;
+    f1 += w1 * u + w3 * (u + a * nx) + w4 * (u - a * nx);
+    f2 += w1 * v + w3 * (v + a * ny) + w4 * (v - a * ny);
+    f3 += w1 * 0.5 * q2 + w3 * (H + a * Vn) + w4 * (H - a * Vn);
+}
+
+// Adds the Steger-Warming split flux of one cell state through a face with unit
+// normal (nx, ny) and length len. sign = +1 keeps the non-negative eigenvalues
+// (upwind side), sign = -1 the non-positive ones (downwind side). Templated on
+// the state type so the implicit solver can differentiate it with dual numbers.
+template <typename T>
+inline void splitFlux(double gamma, double sign,
+                      T rho, T rhoU, T rhoV, T E,
+                      double nx, double ny, double len,
+                      T &f0, T &f1, T &f2, T &f3) {
+    using std::sqrt;
+    const T u = rhoU / rho;
+    const T v = rhoV / rho;
+    const T q2 = u * u + v * v;
+    const T P = (gamma - 1.0) * (E - 0.5 * rho * q2);
+    const T a = sqrt(gamma * P / rho);
+    const T H = (E + P) / rho;
+    addSplitFlux(gamma, sign, rho, u, v, q2, a, H, nx, ny, len, f0, f1, f2, f3);
+}
+
+// Same, from the primitive variables of a reconstructed face state
+inline void splitFluxPrimitive(double gamma, double sign,
+                               double rho, double u, double v, double P,
+                               double nx, double ny, double len,
+                               double &f0, double &f1, double &f2, double &f3) {
+    const double q2 = u * u + v * v;
+    const double a2 = gamma * P / rho;
+    const double H = a2 / (gamma - 1.0) + 0.5 * q2;
+    addSplitFlux(gamma, sign, rho, u, v, q2, std::sqrt(a2), H, nx, ny, len, f0, f1, f2, f3);
+}
+
+// Sum of the convective spectral radii |V.S| + a|S| of a cell in xi and eta,
+// from its state and its cell-averaged face area vectors (sxX, sxY) and
+// (seX, seY). The local time step is cfl * V / spectralRadius.
+inline double spectralRadius(double gamma, double rho, double rhoU, double rhoV, double E,
+                             double sxX, double sxY, double seX, double seY) {
+    const double u = rhoU / rho;
+    const double v = rhoV / rho;
+    const double P = (gamma - 1.0) * (E - 0.5 * rho * (u * u + v * v));
+    const double a = std::sqrt(gamma * P / rho);
+    const double lamXi = std::fabs(u * sxX + v * sxY) + a * std::hypot(sxX, sxY);
+    const double lamEta = std::fabs(u * seX + v * seY) + a * std::hypot(seX, seY);
+    return lamXi + lamEta;
+}
+
+// Limited slope of a cell from its differences to the neighbours below (a) and
+// above (b). Jumps large against sqrt(eps2) get the limiter itself: minmod and
+// van Leer are zero at extrema and keep the face values between the cell
+// values (TVD); van Albada is not, e.g. a = 1, b = -2 gives 0.4. Jumps small
+// against it blend towards the unlimited average, so no limiter is TVD there:
+// without the blend the limiter switches on round-off sized differences
+// behind a shock and the residual hangs in a limit cycle. For van Albada this
+// is its classical epsilon form. Written without branches so the row loops
+// vectorize.
+template <Limiter L>
+inline double limitedSlope(double a, double b, double eps2) {
+    const double ab = a * b;
+    const double s2 = a * a + b * b;
+    double limited; // limited slope times a^2 + b^2
+    if constexpr (L == Limiter::Minmod) {
+        limited = (std::copysign(0.5, a) + std::copysign(0.5, b)) * std::min(std::fabs(a), std::fabs(b)) * s2;
+    } else if constexpr (L == Limiter::VanAlbada) {
+        limited = ab * (a + b);
+    } else {
+        // 2ab / (a + b) where ab > 0
+        const double sum = a + b;
+        limited = (ab + std::fabs(ab)) / (sum + std::copysign(1e-300, sum)) * s2;
+    }
+    return (limited + 0.5 * eps2 * (a + b)) / (s2 + eps2);
+}
+
+// Jump below which the MUSCL slopes are hardly limited, relative to the larger
+// of the cell value and the freestream value of the variable (the speed for u
+// and v), so v, about zero in the freestream, still gets a floor. Scaling
+// rho and P by the freestream alone stalls multigrid behind the shocks, where
+// they are several times larger; smaller values stall the residual on the
+// wedge case, larger ones trade the monotonicity of the shocks for sharpness.
+constexpr double smoothJump = 0.05;
+
+// One pass of FluxSolver::advance
+struct FusedStep {
+    double cfl = 0.8;
+    int steps = 1;                        // pseudo-time steps per pass (temporal blocking)
+    const Initialize *boundary = nullptr; // sets the ghosts between the steps of a pass
+    const FlowState *forcing = nullptr;   // subtracted from R (FAS forcing), nullptr = none
+};
+
+// Steger-Warming flux vector splitting residual on the halo-extended cell grid.
+// Xi face i separates cells i-1 and i, eta face j separates cells j-1 and j.
+// With Reconstruction::MUSCL the split fluxes are those of the face states
+// reconstructed from cells i-2 .. i+1, which reach into the second ghost layer
+// of the state at the boundaries.
+class FluxSolver {
+public:
+    // grid must already be halo-extended by computeCellMetrics(); the interior
+    // is swept in tiles of tileNI x tileNJ cells (0 = whole extent). With
+    // Precision::Mixed the face metrics are kept in float only, for the float
+    // overloads below.
+    FluxSolver(const GridHandler &grid, double gamma, int tileNI = 256, int tileNJ = 16,
+               Precision precision = Precision::Double,
+               Reconstruction reconstruction = Reconstruction::FirstOrder,
+               Limiter limiter = Limiter::VanAlbada);
+
+    // R = sum of outward split fluxes for every interior cell (halo entries
+    // untouched), tiles in parallel
+    void computeResidual(const FlowState &Q, FlowState &R);
+
+    // same, restricted to the cells of region (e.g. the part of a block that
+    // does not depend on inter-block ghosts)
+    void computeResidual(const FlowState &Q, FlowState &R, const Tile &region);
+
+    // float storage (Precision::Mixed): fluxes are formed and summed in double,
+    // only the stored R is rounded to float
+    void computeResidual(const FlowStateF &Q, FlowStateF &R);
+
+    // same, only on the tiles t with active[t] != 0 (converged-region
+    // freezing); R keeps its values elsewhere
+    void computeResidual(const FlowState &Q, FlowState &R, const std::vector<unsigned char> &active);
+    void computeResidual(const FlowStateF &Q, FlowStateF &R, const std::vector<unsigned char> &active);
+
+    // Fused forward Euler with local time steps, tile by tile: each tile
+    // copies its cells plus step.steps layers of neighbours into a window that
+    // stays in cache, marches the window step.steps pseudo-time steps (fluxes,
+    // dt, residual sums and update row by row) and writes its own cells to
+    // Qnext. The overlapping layers are recomputed by both tiles (trapezoidal
+    // temporal blocking), so Q is read and Qnext written once per pass. Q must
+    // have its ghosts set; Qnext's ghosts are left alone. sums[m * tiles + t]
+    // receives the residual sums (as ResidualMonitor::sums) of tile t in step m.
+    // The fluxes are always first order.
+    template <typename Real>
+    void advance(const BasicFlowState<Real> &Q, BasicFlowState<Real> &Qnext,
+                 const AlignedVector<Real> &invVolume, const FusedStep &step,
+                 std::vector<ResidualNorms> &sums);
+
+    // freestream scales of the MUSCL limiter for rho, u and v (both the
+    // speed) and P; until set only the cell values scale it
+    void setReferenceState(double rho, double speed, double P);
+
+    // split flux through a single face of Q as the double sweeps form it: xi
+    // face i of row j (between cells i-1 and i) if xiFace, else eta face j of
+    // column i (between cells j-1 and j). For the flux registers of AdaptiveMesh.
+    void faceFlux(const FlowState &Q, bool xiFace, int i, int j, double f[4]) const;
+
+    // instruction set the kernel was compiled for
+    static const char *simdTarget();
+
+    // getter methods
+    int getNI() const { return ni; }
+    int getNJ() const { return nj; }
+    double getGamma() const { return gamma; }
+    Precision getPrecision() const { return precision; }
+    Reconstruction getReconstruction() const { return reconstruction; }
+    Limiter getLimiter() const { return limiter; }
+    const FaceMetrics &getXiFaces() const { return xiFaces; }
+    const FaceMetrics &getEtaFaces() const { return etaFaces; }
+    const FaceMetricsF &getXiFacesF() const { return xiFacesF; }
+    const FaceMetricsF &getEtaFacesF() const { return etaFacesF; }
+    const TileDecomposition &getTiles() const { return tiles; }
+
+private:
+    // per-sweep scratch: xi-face fluxes of the current row and the eta-face
+    // fluxes below and above it, 4 padded rows each; advance() adds the tile
+    // window and the residual and dt of the two rows not yet updated
+    struct Workspace {
+        AlignedVector<double> xiFlux;
+        AlignedVector<double> etaLo;
+        AlignedVector<double> etaHi;
+        AlignedVector<double> rowR;  // 2 x 4 rows
+        AlignedVector<double> rowDt; // 2 rows
+        FlowState window;
+        FlowStateF windowF;
+        FlowState primitive; // MUSCL: rho, u, v, P of grid row j in row j & 3
+    };
+
+    template <typename Real>
+    void sweepRegion(const BasicFlowState<Real> &Q, BasicFlowState<Real> &R, const Tile &region,
+                     const BasicFaceMetrics<Real> &xi, const BasicFaceMetrics<Real> &eta,
+                     const std::vector<unsigned char> *active = nullptr);
+    void reserveWorkspace(Workspace &ws) const;
+    template <typename Real>
+    void sweepTile(const BasicFlowState<Real> &Q, BasicFlowState<Real> &R, const Tile &tile, Workspace &ws,
+                   const BasicFaceMetrics<Real> &xi, const BasicFaceMetrics<Real> &eta) const;
+    template <Limiter L, typename Real>
+    void sweepTileMUSCL(const BasicFlowState<Real> &Q, BasicFlowState<Real> &R, const Tile &tile, Workspace &ws,
+                        const BasicFaceMetrics<Real> &xi, const BasicFaceMetrics<Real> &eta) const;
+    // R of the tile from xiRow(j, F), the xi-face fluxes of row j, and
+    // etaRow(j, G), the fluxes of eta face j
+    template <typename Real, typename XiRow, typename EtaRow>
+    void differenceFluxes(BasicFlowState<Real> &R, const Tile &tile, Workspace &ws,
+                          XiRow &&xiRow, EtaRow &&etaRow) const;
+    template <typename Real>
+    void advanceTile(const BasicFlowState<Real> &Q, BasicFlowState<Real> &Qnext,
+                     const AlignedVector<Real> &invVolume, const FusedStep &step,
+                     const Tile &tile, Workspace &ws, ResidualNorms *sums, int tileStride,
+                     const BasicFaceMetrics<Real> &xi, const BasicFaceMetrics<Real> &eta) const;
+    // fluxes of row j of Q between iBegin and iEnd; Q may be a window whose
+    // cell (0, 0) is cell (i0, j0) of the grid the metrics belong to
+    template <typename Real>
+    void xiFluxRow(const BasicFlowState<Real> &Q, const BasicFaceMetrics<Real> &xi,
+                   int j, int iBegin, int iEnd, double *F, int i0 = 0, int j0 = 0) const;
+    template <typename Real>
+    void etaFluxRow(const BasicFlowState<Real> &Q, const BasicFaceMetrics<Real> &eta,
+                    int j, int iBegin, int iEnd, double *G, int i0 = 0, int j0 = 0) const;
+    // MUSCL: primitive variables of row j of Q between iBegin and iEnd, and
+    // the fluxes of the faces reconstructed from them
+    template <typename Real>
+    void primitiveRow(const BasicFlowState<Real> &Q, int j, int iBegin, int iEnd, FlowState &W) const;
+    template <Limiter L, typename Real>
+    void xiFluxRowMUSCL(const FlowState &W, const BasicFaceMetrics<Real> &xi,
+                        int j, int iBegin, int iEnd, double *F) const;
+    template <Limiter L, typename Real>
+    void etaFluxRowMUSCL(const FlowState &W, const BasicFaceMetrics<Real> &eta,
+                         int j, int iBegin, int iEnd, double *G) const;
+
+    int ni, nj;     // cells in i and j, including halos
+    int stride;     // padded row length of the double workspace (same as FlowState)
+    double gamma;   // ratio of specific heats
+    Precision precision;
+    Reconstruction reconstruction;
+    Limiter limiter;
+    double jumpScale2[4] = {1e-300, 1e-300, 1e-300, 1e-300}; // freestream eps2 floor of rho, u, v, P
+    FaceMetrics xiFaces;   // Precision::Double
+    FaceMetrics etaFaces;
+    FaceMetricsF xiFacesF; // Precision::Mixed
+    FaceMetricsF etaFacesF;
+    TileDecomposition tiles;
+    std::vector<Workspace> scratch; // one per thread
+};
+
+#endif  // FLUXSOLVER_H
@@ -0,0 +1,47 @@
+#ifndef GRIDGENERATOR_H
+#define GRIDGENERATOR_H
+
+#include <string>
+#include "GridHandler.h"
+
+// Channel geometries of the README test cases. The channel runs along x from
+// the inlet at x = 0 between a lower wall at y = 0 and an upper wall at
+// y = height; one of them turns by the ramp angle at x = corner and back at
+// the end of the ramp.
+enum class GridGeometry {
+    Wedge,      // lower wall turns into the flow (attached oblique shock)
+    Expansion,  // lower wall turns away from the flow (Prandtl-Meyer fan)
+    Reflection  // upper wall turns into the flow and back: its shock reflects off the lower
+                // wall and runs into the expansion fan from the end of the ramp
+};
+
+// Parameters of a generated grid
+struct GridSpec {
+    GridGeometry geometry = GridGeometry::Wedge;
+    int ni = 641;            // nodes along the channel
+    int nj = 65;             // nodes across the channel
+    double length = 3.0;     // channel length
+    double height = 1.0;     // channel height at the inlet
+    double corner = 0.5;     // x where the ramp starts
+    double angle = 10.0;     // [deg] wall turning angle
+    double rampLength = 0.0; // x extent of the ramp (0 = up to the outlet; parseGridSpec
+                             // defaults it to 1 for reflection)
+    double stretchI = 0.0;   // tanh clustering of the columns at the ramp ends (0 = uniform)
+    double stretchJ = 0.0;   // tanh clustering of the rows at the ramp wall (0 = uniform)
+};
+
+// Builds the nodes of spec into grid, in the layout readGridFile produces
+// (computeCellMetrics still to be called). Columns are vertical lines with
+// nodes on both ramp ends, so the wall corners are exact at any resolution.
+// False (with a message) if the parameters do not give a valid channel.
+bool generateGrid(const GridSpec &spec, GridHandler &grid);
+
+// Parses "geometry[:key=value,...]", e.g. "wedge:ni=1281,nj=129,angle=15".
+// Keys: ni, nj, length, height, corner, angle, ramp, stretchi, stretchj.
+// reflection starts from ramp = 1 (without it the case is the wedge mirrored).
+bool parseGridSpec(const std::string &text, GridSpec &spec);
+
+// true if text starts with a geometry name (a spec rather than a file name)
+bool isGridSpec(const std::string &text);
+
+#endif  // GRIDGENERATOR_H
@@ -9,7 +9,29 @@ public:
     GridHandler();
     
     // Reads the grid file, parses header information, and maps the data into matrices.
+    // The file is memory-mapped and large files are parsed by several threads.
     bool readGridFile(const std::string &filename);
+
+    // Writes the nodes in the text format readGridFile reads (halo layer dropped
+    // once the metrics are computed).
+    bool writeGridFile(const std::string &filename) const;
+
+    // Takes the nodes of a grid built in memory, in readGridFile's layout:
+    // x(i, j) and y(i, j) with i along the channel and j from the lower wall up.
+    void setNodes(Eigen::MatrixXd xNodes, Eigen::MatrixXd yNodes);
+
+    // Writes the nodes and, once computed, the halo-extended metrics to a binary
+    // cache. source (optional) is the text grid it was built from; its size and
+    // modification time are recorded so stale caches can be detected.
+    bool writeCache(const std::string &filename, const std::string &source = "") const;
+
+    // Loads a cache written by writeCache. With source given, fails if the
+    // cache was built from a different or since modified file.
+    bool readCache(const std::string &filename, const std::string &source = "");
+
+    // readCache if cacheFile is up to date with gridFile, otherwise readGridFile,
+    // computeCellMetrics and a fresh writeCache.
+    bool loadGrid(const std::string &gridFile, const std::string &cacheFile);
     
     // Augments the grid by adding halo cells on all four boundaries.
     void haloCell();
@@ -17,12 +39,33 @@ public:
     // Calculates the cell center and volume for each cell and calculates the face areas in the xi and eta directions.
     void computeCellMetrics();
 
+    // Builds this grid as the 2:1 agglomeration of an already halo-extended fine
+    // grid (volumes and face areas summed from the fine cells), halos included.
+    bool agglomerate(const GridHandler &fine);
+
+    // Builds this grid as the block of cells [iBegin, iEnd) x [jBegin, jEnd) of an
+    // already halo-extended grid (only its nodes are used). The block's ghost
+    // layer is cut from the neighbouring cells, so metrics match the full grid.
+    bool extractBlock(const GridHandler &global, int iBegin, int iEnd, int jBegin, int jEnd);
+
+    // Takes the halo-extended nodes of a block as extractBlock cuts them (e.g.
+    // sent by the rank holding the global grid) and computes its metrics.
+    void setBlockNodes(Eigen::MatrixXd xNodes, Eigen::MatrixXd yNodes);
+
+    // Builds this grid as the cells [iBegin, iEnd) x [jBegin, jEnd) of an already
+    // halo-extended grid split ratio x ratio, nodes interpolated bilinearly in
+    // each parent cell (straight walls stay exact). The ghost layer is cut from
+    // the neighbouring parent cells, and the children of a cell add up to it.
+    bool refineBlock(const GridHandler &parent, int iBegin, int iEnd, int jBegin, int jEnd, int ratio);
+
     // Creates a new figure window and plots the grid (using matplot).
     void plotGrid(const std::string &windowTitle);
 
     // getter methods
     const int &getNX() const { return nx; }
     const int &getNY() const { return ny; }
+    int getCellNX() const { return nx - 1; } // cells in i, including the halo layer
+    int getCellNY() const { return ny - 1; } // cells in j, including the halo layer
     const Eigen::MatrixXd &getX() const { return x; }
     const Eigen::MatrixXd &getY() const { return y; }
     const Eigen::MatrixXd &getXCenter() const { return xCenter; }
@@ -34,16 +77,19 @@ public:
     const Eigen::MatrixXd &getYAreaEta() const { return yArea_Eta; }
 
 private:
+    // cell centers, volumes and face areas from the halo-extended nodes
+    void computeMetricsFromNodes();
+
     int nx, ny; // total grid points for i and j component
     Eigen::MatrixXd x; // grid nodes in i-component
     Eigen::MatrixXd y; // grid nodes in j-component
     Eigen::MatrixXd xCenter; // cell centers for i-component
     Eigen::MatrixXd yCenter; // cell centers for j-component
     Eigen::MatrixXd cellVolume; // cell volumes
-    Eigen::MatrixXd xArea_Eta; // face areas for i-component in eta direction
-    Eigen::MatrixXd yArea_Eta; // face areas for j-component in eta direction
-    Eigen::MatrixXd xArea_Xi;  // face areas for i-component in xi direction
-    Eigen::MatrixXd yArea_Xi; // face areas for j-component in xi direction
+    Eigen::MatrixXd xArea_Eta; // x-component of the +eta face area vectors (node lines j = 1..ny-2)
+    Eigen::MatrixXd yArea_Eta; // y-component of the +eta face area vectors
+    Eigen::MatrixXd xArea_Xi;  // x-component of the +xi face area vectors (node lines i = 1..nx-2)
+    Eigen::MatrixXd yArea_Xi; // y-component of the +xi face area vectors
 };
 
 #endif  // COMPUTATIONALGRID_H
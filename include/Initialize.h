@@ -2,23 +2,69 @@
 #define INITIALIZE_H
 
 #include <Eigen/Dense>
+#include <array>
+#include "FlowState.h"
+#include "PrimitiveState.h"
 #include "GridHandler.h"
+#include "Parallel.h"
+
+// Block sides, in the order boundary types are given
+enum Side { WEST = 0, EAST = 1, SOUTH = 2, NORTH = 3 };
+
+// Boundary condition imposed on the ghost cells of one side
+enum class BoundaryType {
+    Inlet,     // supersonic inflow, freestream ghosts
+    Outlet,    // supersonic outflow, zero gradient
+    Wall,      // inviscid slip wall, mirrored velocity
+    InterBlock // ghosts filled from the neighbouring block (halo exchange)
+};
 
 class Initialize {
 public:
-    Initialize(GridHandler &grid,
+    // Eigen view of one conserved variable inside the padded FlowState planes
+    using StateMap = Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64, Eigen::OuterStride<>>;
+
+    // grid must already be halo-extended by computeCellMetrics()
+    Initialize(const GridHandler &grid,
                double R,
                double gamma,
                double Cp);
 
+    Initialize(const Initialize &) = delete;
+    Initialize &operator=(const Initialize &) = delete;
+
     // fill interior cells with uniform P0, T0, M0
     void setInitialConditions(double P0,
                               double T0,
                               double M0);
 
-    // impose BCs on the halo (ghost) cells
+    // impose BCs on both layers of halo (ghost) cells; InterBlock sides are left alone
     void applyBoundaryConditions();
 
+    // same, on another state of this grid (e.g. the float copy of a
+    // Precision::Mixed solver)
+    template <typename Real>
+    void applyBoundaryConditions(BasicFlowState<Real> &Q) const;
+
+    // same, on the cells [window.iBegin, window.iEnd) x [window.jBegin,
+    // window.jEnd) of the grid held in W from W(k, 0, 0) on; only the ghosts
+    // inside the window are set. Serial and untimed, for the tile windows of
+    // the fused sweep.
+    template <typename Real>
+    void applyBoundaryConditions(BasicFlowState<Real> &W, const Tile &window) const;
+
+    // exchange the state with Q (same dimensions), e.g. the result of a
+    // double-buffered sweep; the Eigen views follow the new storage
+    void swapState(FlowState &Q);
+
+    // boundary type of each side, [WEST, EAST, SOUTH, NORTH]
+    const std::array<BoundaryType, 4>& getBoundaryTypes() const { return boundary; }
+    void setBoundaryTypes(const std::array<BoundaryType, 4> &types) { boundary = types; }
+
+    // freestream state from setInitialConditions, [rho, rho*u, rho*v, rho*E]
+    const std::array<double, 4>& getFreestream() const { return Qinf; }
+    void setFreestream(const std::array<double, 4> &Q0) { Qinf = Q0; }
+
     // switch from primatives (P, u, v, T) to state vector Q
     void packToQ(
         const Eigen::MatrixXd &P,
@@ -27,34 +73,58 @@ public:
         const Eigen::MatrixXd &T
     );
 
-    // primative fields from Q
-    Eigen::MatrixXd computePressure() const; // pressure
-    Eigen::MatrixXd computeU_Velo() const; // u-component velocity
-    Eigen::MatrixXd computeV_Velo() const; // v-component velocity
-    Eigen::MatrixXd computeTemp() const; // temperature
+    // primative fields P, T, u, v and a from Q in one pass, into a workspace
+    // reused from call to call (the getters below read the last result)
+    const PrimitiveState &computePrimitives();
 
     // getter methods
-    const std::array<Eigen::MatrixXd,4>& getQ() const { return Q; }
-    const Eigen::MatrixXd& getRho()    const { return Q[RHO]; }
-    const Eigen::MatrixXd& getRhoU()   const { return Q[RHO_U]; }
-    const Eigen::MatrixXd& getRhoV()   const { return Q[RHO_V]; }
-    const Eigen::MatrixXd& getEnergy() const { return Q[ENERGY]; }
+    const std::array<StateMap,4>& getQ() const { return Q; }
+    const StateMap& getRho()    const { return Q[RHO]; }
+    const StateMap& getRhoU()   const { return Q[RHO_U]; }
+    const StateMap& getRhoV()   const { return Q[RHO_V]; }
+    const StateMap& getEnergy() const { return Q[ENERGY]; }
+    FlowState& getState() { return state; }
+    const FlowState& getState() const { return state; }
+    const PrimitiveState& getPrimitives() const { return primitives; }
+    PrimitiveState::FieldMap getPressure() const { return primitives.map(PrimitiveState::PRESSURE); }
+    PrimitiveState::FieldMap getTemp()     const { return primitives.map(PrimitiveState::TEMPERATURE); }
+    PrimitiveState::FieldMap getU_Velo()   const { return primitives.map(PrimitiveState::U_VELO); }
+    PrimitiveState::FieldMap getV_Velo()   const { return primitives.map(PrimitiveState::V_VELO); }
+    PrimitiveState::FieldMap getSoundSpeed() const { return primitives.map(PrimitiveState::SOUND_SPEED); }
+    double getGamma() const { return gamma; }
+    double getR() const { return R; }
+    double getCp() const { return Cp; }
 
         // index enum for Q components
         enum Conserved { RHO = 0, RHO_U = 1, RHO_V = 2, ENERGY = 3 };
 
 private:
-    GridHandler &grid;
+    const GridHandler &grid;
     double R;         // gas constant
     double gamma;     // ratio of heats
     double Cp;        // [J / kg*K] specific heat
 
     // individual BC helpers (called by applyBoundaryConditions)
-    void setInletConditions();
-    void setOutletConditions();
-    void setWallConditions();
+    template <typename Real>
+    void imposeBoundaryConditions(BasicFlowState<Real> &Q, const Tile &window, bool parallel) const;
+    template <typename Real>
+    void setInletConditions(BasicFlowState<Real> &Q, const Tile &window, bool parallel) const;
+    template <typename Real>
+    void setOutletConditions(BasicFlowState<Real> &Q, const Tile &window, bool parallel) const;
+    template <typename Real>
+    void setWallConditions(BasicFlowState<Real> &Q, const Tile &window, bool parallel,
+                           bool south, bool north) const;
+
+    // size the state to the grid's cells and point Q at its planes
+    void allocate();
+    void bindViews();
 
-    std::array<Eigen::MatrixXd, 4> Q; // state vector, [rho, rho*u, rho*v, rho*E]
+    std::array<double, 4> Qinf{}; // freestream state imposed at the inlet
+    std::array<BoundaryType, 4> boundary{BoundaryType::Inlet, BoundaryType::Outlet,
+                                         BoundaryType::Wall, BoundaryType::Wall};
+    FlowState state; // padded SoA storage behind Q
+    PrimitiveState primitives; // workspace of computePrimitives()
+    std::array<StateMap, 4> Q; // state vector, [rho, rho*u, rho*v, rho*E]
 };
 
 #endif  // INITIALIZE_H
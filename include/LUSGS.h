@@ -0,0 +1,51 @@
+#ifndef LUSGS_H
+#define LUSGS_H
+
+#include <Eigen/Dense>
+#include <array>
+#include <vector>
+#include "FlowState.h"
+#include "FluxSolver.h"
+#include "Initialize.h"
+#include "Parallel.h"
+
+// Implicit LU-SGS update built on the Steger-Warming split Jacobians A+ and A-.
+// Only the 4x4 diagonal block of every cell is stored (as its inverse); the
+// off-diagonal products are applied on the fly during the two sweeps.
+class LUSGS {
+public:
+    // flux supplies the face metrics and boundary selects the implicit wall /
+    // outlet terms; the face Jacobians are re-linearized every
+    // jacobianInterval updates
+    LUSGS(const FluxSolver &flux, const std::array<BoundaryType, 4> &boundary,
+          int jacobianInterval = 1);
+
+    // solve (D + L) D^-1 (D + U) dQ = -R for the given per-cell dt and add dQ
+    // to Q; dt and invVolume are padded like FlowState
+    void update(FlowState &Q, const FlowState &R, const AlignedVector<double> &dt,
+                const AlignedVector<double> &invVolume);
+
+private:
+    // sum over faces of the outward A+ blocks (plus wall and outlet coupling)
+    void buildFaceJacobians(const FlowState &Q, const Tile &tile);
+
+    // D = V/dt I + face Jacobians, stored inverted
+    void buildDiagonal(const FlowState &Q, const AlignedVector<double> &dt,
+                       const AlignedVector<double> &invVolume);
+
+    // lower and upper sweeps over one tile, called in wavefront order
+    void forwardSweep(const FlowState &Q, const FlowState &R, const Tile &tile);
+    void backwardSweep(const FlowState &Q, const Tile &tile);
+
+    const FluxSolver &flux;
+    std::array<BoundaryType, 4> boundary;
+    double gamma;
+    int ni, nj, stride;
+    int jacobianInterval;
+    long updates = 0;
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> faceJacobian; // one per cell
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> Dinv;         // one per cell
+    FlowState dQ; // increment, zero in the halos
+};
+
+#endif  // LUSGS_H
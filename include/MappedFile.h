@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped
+// so parsing reads straight from the page cache; elsewhere it is read into a
+// buffer once.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // map filename, replacing any previous mapping
+    bool open(const std::string &filename);
+    void close();
+
+    // getter methods
+    const char *data() const { return ptr; }
+    std::size_t size() const { return length; }
+
+private:
+    const char *ptr = nullptr;
+    std::size_t length = 0;
+    bool mapped = false;      // ptr came from mmap
+    std::vector<char> buffer; // fallback storage
+};
+
+#endif  // MAPPEDFILE_H
@@ -0,0 +1,77 @@
+#ifndef MULTIBLOCK_H
+#define MULTIBLOCK_H
+
+#include <mpi.h>
+#include <array>
+#include <memory>
+#include <vector>
+#include "BlockCoupling.h"
+#include "BlockDecomposition.h"
+#include "GridHandler.h"
+#include "Initialize.h"
+#include "Solver.h"
+
+// Multi-block driver: every MPI rank owns one block of the global grid with its
+// own GridHandler, Initialize and Solver. Sides shared with another block are
+// InterBlock boundaries whose ghost cells are refreshed by a non-blocking halo
+// exchange, overlapped with the interior part of the residual.
+class MultiBlock : public BlockCoupling {
+public:
+    // global is only read on rank 0, where it must be halo-extended (haloCell()
+    // or computeCellMetrics()); the other ranks pass an empty grid. Rank 0
+    // sends every rank the nodes of its block, so each keeps just that block.
+    MultiBlock(const GridHandler &global, double R, double gamma, double Cp,
+               MPI_Comm comm = MPI_COMM_WORLD);
+    ~MultiBlock() override;
+
+    MultiBlock(const MultiBlock &) = delete;
+    MultiBlock &operator=(const MultiBlock &) = delete;
+
+    // uniform P0, T0, M0 in this block
+    void setInitialConditions(double P0, double T0, double M0);
+
+    // march every block until the global residual converges; true if converged
+    bool run(const SolverOptions &options);
+
+    // copy the interior cells of all blocks into global, which is only used
+    // (and may be nullptr elsewhere) on root; called by every rank
+    void gather(Initialize *global, int root = 0) const;
+
+    // BlockCoupling
+    void beginExchange(FlowState &Q) override;
+    void finishExchange(FlowState &Q) override;
+    ResidualNorms reduceNorms(const ResidualNorms &sums, double cells) override;
+    double reduceMin(double value) override;
+
+    // getter methods
+    int getRank() const { return rank; }
+    int getSize() const { return size; }
+    const Block &getBlock() const { return block; }
+    GridHandler &getGrid() { return grid; }
+    Initialize &getInit() { return *init; }
+    int getIterations() const { return solver ? solver->getMonitor().getIterations() : 0; }
+
+private:
+    // ghost / first-interior strip of one side: offset of its first cell,
+    // stride between cells and cell count
+    struct Strip {
+        int first;
+        int step;
+        int count;
+    };
+    Strip ghostStrip(int side) const;
+    Strip interiorStrip(int side) const;
+
+    MPI_Comm comm;
+    int rank, size;
+    BlockDecomposition decomposition;
+    Block block;
+    GridHandler grid;
+    std::unique_ptr<Initialize> init;
+    std::unique_ptr<Solver> solver;
+    std::array<std::vector<double>, 4> sendBuffer; // per side, 4 variables per cell
+    std::array<std::vector<double>, 4> recvBuffer;
+    std::vector<MPI_Request> requests;
+};
+
+#endif  // MULTIBLOCK_H
@@ -0,0 +1,85 @@
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "FlowState.h"
+#include "GridHandler.h"
+#include "Initialize.h"
+#include "ResidualMonitor.h"
+#include "Solver.h"
+
+// Full Approximation Scheme controls
+struct MultigridOptions {
+    int levels = 4;          // grid levels including the finest (each 2:1 coarser)
+    int minCells = 8;        // coarsest level keeps at least this many cells per direction
+    int cycleIndex = 2;      // 1 = V-cycle, 2 = W-cycle
+    int preSmooth = 1;       // smoothing steps before restriction
+    int postSmooth = 1;      // smoothing steps after prolongation (at least 1: its residual judges the cycle)
+    int coarseSmooth = 4;    // smoothing steps on the coarsest level
+    int maxCycles = 2000;    // cycles on the finest level
+    bool fullMultigrid = true; // start from the coarsest level (FMG)
+    int fmgCycles = 20;      // cycles per intermediate FMG level
+};
+
+// FAS multigrid on agglomerated coarse levels of the fine grid, with the
+// explicit Solver as the smoother on every level.
+class Multigrid {
+public:
+    // grid must already be halo-extended, init must hold the initial state.
+    // coarseGrids are prebuilt levels from agglomerateLevels() (read only,
+    // e.g. shared by the cases of a sweep); nullptr = agglomerate here.
+    Multigrid(const GridHandler &grid, Initialize &init,
+              const SolverOptions &solverOptions,
+              const MultigridOptions &options,
+              const std::vector<std::unique_ptr<GridHandler>> *coarseGrids = nullptr);
+
+    // the 2:1 agglomerated coarse levels of grid, coarsest last
+    static std::vector<std::unique_ptr<GridHandler>> agglomerateLevels(const GridHandler &grid,
+                                                                       const MultigridOptions &options);
+
+    // march the finest level until converged, stalled or maxCycles; true if converged.
+    // Checkpoints every SolverOptions::checkpointInterval cycles.
+    bool run();
+
+    // start from a checkpoint of the finest level instead of FMG; cycles
+    // continue from the restored count
+    bool restart(const std::string &filename);
+
+    // start the finest level from Q0 instead of FMG (see Solver::warmStart)
+    bool warmStart(const FlowState &Q0);
+
+    // one FAS cycle (V or W) starting at the given level
+    void cycle(int level);
+
+    // getter methods
+    int getLevels() const { return static_cast<int>(levels.size()); }
+    double getWorkUnits() const { return workUnits; }
+    const ResidualMonitor &getMonitor() const { return monitor; }
+
+private:
+    struct Level {
+        const GridHandler *grid = nullptr; // level geometry (owned by coarse levels unless shared)
+        Initialize *init = nullptr;       // level state (owned by coarse levels)
+        std::unique_ptr<GridHandler> ownedGrid;
+        std::unique_ptr<Initialize> ownedInit;
+        std::unique_ptr<Solver> solver;
+        FlowState forcing;                // FAS forcing P
+        FlowState restricted;             // Q right after restriction
+        double workPerSweep = 1.0;        // cells relative to the finest level
+    };
+
+    void smooth(int level, int steps);
+    void restrictToCoarse(int level, bool withForcing);
+    void prolongateCorrection(int level);
+    void solveLevel(int level, int cycles);
+
+    MultigridOptions options;
+    std::vector<Level> levels;
+    ResidualMonitor monitor;
+    double workUnits = 0.0; // fine-grid sweep equivalents spent so far
+    bool restarted = false; // fine state came from a checkpoint
+};
+
+#endif  // MULTIGRID_H
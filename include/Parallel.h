@@ -0,0 +1,90 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <vector>
+
+// Shared-memory execution layer. With EULER_OPENMP the loops below are spread
+// over the OpenMP threads with a static schedule, so a given thread count
+// always maps the same tiles to the same threads (first-touch placement and
+// reductions stay reproducible); without it they run serially.
+#if defined(_OPENMP)
+#define EULER_PRAGMA_PARALLEL_FOR _Pragma("omp parallel for schedule(static)")
+#define EULER_PRAGMA_PARALLEL _Pragma("omp parallel")
+#define EULER_PRAGMA_FOR _Pragma("omp for schedule(static)")
+#else
+#define EULER_PRAGMA_PARALLEL_FOR
+#define EULER_PRAGMA_PARALLEL
+#define EULER_PRAGMA_FOR
+#endif
+
+// number of threads the parallel loops use, and the calling thread's index
+int getThreadCount();
+int getThreadIndex();
+void setThreadCount(int threads);
+
+// Rectangular block of cells [iBegin, iEnd) x [jBegin, jEnd)
+struct Tile {
+    int iBegin, iEnd;
+    int jBegin, jEnd;
+};
+
+// Splits the interior cells of an ni x nj halo-extended cell grid into tiles of
+// at most tileNI x tileNJ. Tiles are numbered band by band (i fastest) so a
+// static schedule hands every thread a contiguous range of rows.
+class TileDecomposition {
+public:
+    TileDecomposition();
+    TileDecomposition(int ni, int nj, int tileNI, int tileNJ);
+
+    // getter methods
+    int getTileCount() const { return static_cast<int>(tiles.size()); }
+    int getTilesI() const { return tilesI; }
+    int getTilesJ() const { return tilesJ; }
+    const Tile &getTile(int t) const { return tiles[t]; }
+    const Tile &getTile(int a, int b) const { return tiles[b * tilesI + a]; }
+
+private:
+    int tilesI, tilesJ; // tiles in i and j
+    std::vector<Tile> tiles;
+};
+
+// body(n) for n in [begin, end)
+template <typename Body>
+void parallelFor(int begin, int end, Body &&body) {
+    EULER_PRAGMA_PARALLEL_FOR
+    for (int n = begin; n < end; ++n) {
+        body(n);
+    }
+}
+
+// body(tile) for every tile, tiles are independent
+template <typename Body>
+void forEachTile(const TileDecomposition &tiles, Body &&body) {
+    const int count = tiles.getTileCount();
+    EULER_PRAGMA_PARALLEL_FOR
+    for (int t = 0; t < count; ++t) {
+        body(tiles.getTile(t));
+    }
+}
+
+// body(tile) in wavefront order: a tile runs only after its lower-i and lower-j
+// neighbours (forward) or upper-i and upper-j neighbours (backward) finished, so
+// Gauss-Seidel type sweeps give the same result as the serial sweep.
+template <typename Body>
+void forEachTileWavefront(const TileDecomposition &tiles, bool forward, Body &&body) {
+    const int nI = tiles.getTilesI();
+    const int nJ = tiles.getTilesJ();
+    const int fronts = nI + nJ - 1;
+    EULER_PRAGMA_PARALLEL
+    for (int n = 0; n < fronts; ++n) {
+        const int d = forward ? n : fronts - 1 - n;
+        const int aBegin = d - nJ + 1 > 0 ? d - nJ + 1 : 0;
+        const int aEnd = d + 1 < nI ? d + 1 : nI;
+        EULER_PRAGMA_FOR
+        for (int a = aBegin; a < aEnd; ++a) {
+            body(tiles.getTile(a, d - a));
+        }
+    }
+}
+
+#endif  // PARALLEL_H
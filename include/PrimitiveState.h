@@ -0,0 +1,48 @@
+#ifndef PRIMITIVESTATE_H
+#define PRIMITIVESTATE_H
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include "FlowState.h"
+
+// Primitive fields derived from a FlowState: pressure, temperature, both
+// velocity components and the speed of sound. All five planes live in one
+// aligned block with the FlowState row padding, allocated once and refilled
+// in place, so computing them every iteration allocates nothing.
+class PrimitiveState {
+public:
+    enum Field { PRESSURE = 0, TEMPERATURE = 1, U_VELO = 2, V_VELO = 3, SOUND_SPEED = 4 };
+    static constexpr int NFIELD = 5;
+
+    // read-only Eigen view of one field
+    using FieldMap = Eigen::Map<const Eigen::MatrixXd, Eigen::Aligned64, Eigen::OuterStride<>>;
+
+    PrimitiveState();
+
+    // (re)allocate for ni x nj cells; a no-op if the size is unchanged
+    void resize(int ni, int nj);
+
+    // fill every field from Q in one pass over the cells (halos included),
+    // resizing first if Q has other dimensions
+    void compute(const FlowState &Q, double gamma, double R);
+
+    // getter methods
+    int getNI() const { return ni; }
+    int getNJ() const { return nj; }
+    int getStride() const { return stride; }
+
+    const double *plane(int f) const { return data.data() + f * planeSize; }
+    const double *row(int f, int j) const { return plane(f) + static_cast<std::size_t>(j) * stride; }
+    double operator()(int f, int i, int j) const { return row(f, j)[i]; }
+    FieldMap map(int f) const { return FieldMap(plane(f), ni, nj, Eigen::OuterStride<>(stride)); }
+
+private:
+    double *row(int f, int j) { return data.data() + f * planeSize + static_cast<std::size_t>(j) * stride; }
+
+    int ni, nj;             // cells in i and j, including halos
+    int stride;             // padded row length, as in FlowState
+    std::size_t planeSize;  // doubles per field
+    AlignedVector<double> data;
+};
+
+#endif  // PRIMITIVESTATE_H
@@ -0,0 +1,98 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// Solver phases timed by the profiler
+enum class Phase {
+    GridRead,    // readGridFile / readCache / generateGrid
+    CellMetrics, // computeCellMetrics
+    Boundary,    // Initialize::applyBoundaryConditions
+    Residual,    // flux residual sweep, reported as flux construction + differencing
+    TimeStep,    // local / global dt
+    Update,      // explicit or LU-SGS update of Q
+    Norms,       // residual norms (and their reduction across blocks)
+    Fused,       // fused tiled step: fluxes, dt and update in one pass
+    Output,      // checkpoint and solution snapshots
+    Count
+};
+
+// Profiling controls for a run. The timers themselves are switched on with
+// Profiler::setEnabled() so they can also cover the grid read before it.
+struct ProfileOptions {
+    int interval = 0;   // iterations (multigrid: cycles) between profile lines (0 = none)
+    std::string report; // end-of-run report, <report>.json and <report>.csv (empty = none)
+};
+
+// Process-wide phase timers and counters, accumulated per thread without a
+// lock. Phase times are wall-clock times on the calling thread; the residual sweep is split into flux construction and
+// differencing by the time the worker threads spent on each. Built without
+// EULER_PROFILE, or while disabled, a timer costs one branch.
+class Profiler {
+public:
+#if defined(EULER_PROFILE)
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+#else
+    static constexpr bool enabled() { return false; }
+#endif
+    static void setEnabled(bool on);
+
+    // restart the clock and zero all timers and counters
+    static void reset();
+
+    // wall time of one call of a phase
+    static void add(Phase phase, double seconds);
+    // flux work of the calling thread inside a residual sweep
+    static void addFluxWork(double construction, double differencing);
+    // a driver iteration (single grid step or multigrid cycle)
+    static void countIteration();
+    // one sweep over `cells` cells (any grid level)
+    static void countCellUpdates(long long cells);
+
+    // heap allocation, counted by the operator new of AllocationCounter.cpp
+    static void countAllocation(std::size_t bytes);
+
+    // heap allocations through operator new since the last reset (0 unless
+    // the executable links AllocationCounter.cpp)
+    static long long getAllocations();
+    static long long getAllocatedBytes();
+    // peak resident set size of the process in bytes (0 if unknown)
+    static long long getPeakMemory();
+
+    // one-line summary of the interval since the previous line
+    static void printLine(std::ostream &out, int iteration);
+    // end-of-run report to prefix.json and prefix.csv
+    static bool writeReport(const std::string &prefix);
+
+private:
+    static std::atomic<bool> active;
+};
+
+// Adds the lifetime of the scope to a phase
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase_) : phase(phase_), timing(Profiler::enabled()) {
+        if (timing) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    ~ScopedTimer() {
+        if (timing) {
+            Profiler::add(phase, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Phase phase;
+    bool timing;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif  // PROFILER_H
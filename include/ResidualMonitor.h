@@ -0,0 +1,73 @@
+#ifndef RESIDUALMONITOR_H
+#define RESIDUALMONITOR_H
+
+#include <array>
+#include <vector>
+#include "FlowState.h"
+
+// L2 and L-infinity norms of the residual, one entry per conserved variable
+struct ResidualNorms {
+    std::array<double, FlowState::NVAR> L2{};
+    std::array<double, FlowState::NVAR> Linf{};
+};
+
+// Tracks the residual norms over the pseudo-time iterations and decides when
+// the solution has converged (relative drop below tolerance) or stalled
+// (no stallRatio reduction within stallWindow iterations).
+class ResidualMonitor {
+public:
+    ResidualMonitor(double tolerance, int stallWindow, double stallRatio);
+
+    // compute the norms of R over the interior cells and append them to the
+    // history; float residuals (Precision::Mixed) are summed in double
+    template <typename Real>
+    const ResidualNorms &record(const BasicFlowState<Real> &R);
+
+    // unnormalized pieces of the norms: sum of R^2 in L2, max |R| in Linf
+    template <typename Real>
+    ResidualNorms sums(const BasicFlowState<Real> &R);
+
+    // append norms that were computed elsewhere (e.g. by a parallel reduction)
+    const ResidualNorms &record(const ResidualNorms &norms);
+
+    // forget the history and the reference norms
+    void reset();
+
+    // measure relative norms against ref instead of the first recorded norms
+    // (warm start from a converged solution, whose own first norms are small)
+    void setReference(const ResidualNorms &ref);
+
+    // replace the history with one saved earlier (restart), replaying the
+    // stall bookkeeping
+    void restore(const std::vector<ResidualNorms> &past);
+
+    bool converged() const;
+    bool stalled() const;
+    bool diverged() const; // last norm is NaN or infinite
+
+    // largest L2 norm over the four equations, relative to the first iteration
+    // or the reference (infinite once the residual has blown up)
+    double relativeL2() const;
+
+    // getter methods
+    int getIterations() const { return static_cast<int>(history.size()); }
+    const ResidualNorms &getLast() const { return history.back(); }
+    const ResidualNorms &getFirst() const { return history.front(); }
+    // norms the relative residual is measured against
+    const ResidualNorms &getReference() const { return hasReference ? reference : history.front(); }
+    const std::vector<ResidualNorms> &getHistory() const { return history; }
+
+private:
+    double tolerance;   // relative L2 reduction that counts as converged
+    int stallWindow;    // iterations allowed without sufficient progress
+    double stallRatio;  // required reduction factor per window
+    double stallRef;    // relative norm at the last sufficient reduction
+    int stallRefIter;   // iteration at which stallRef was recorded
+    bool hasReference = false; // reference set by setReference()
+    ResidualNorms reference;
+    std::vector<ResidualNorms> history;
+    std::vector<double> rowSum;  // per-row partial sums of R^2 (scratch)
+    std::vector<double> rowPeak; // per-row partial maxima of |R| (scratch)
+};
+
+#endif  // RESIDUALMONITOR_H
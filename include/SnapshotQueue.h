@@ -0,0 +1,58 @@
+#ifndef SNAPSHOTQUEUE_H
+#define SNAPSHOTQUEUE_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FlowState.h"
+#include "ResidualMonitor.h"
+
+// Copy of the solver state handed to a background writer
+struct Snapshot {
+    FlowState Q;
+    int iteration = 0;
+    std::vector<ResidualNorms> history; // empty unless requested
+};
+
+// Hands snapshots from the solver to one background thread through two
+// buffers. submit() copies into whichever buffer the thread is not writing and
+// returns; a snapshot still waiting when the next one arrives is replaced
+// (counted as dropped), so the solver never waits for the disk.
+class SnapshotQueue {
+public:
+    // write is called on the background thread, returns false on failure
+    explicit SnapshotQueue(std::function<bool(const Snapshot &)> write);
+    ~SnapshotQueue(); // flushes the pending snapshot
+
+    SnapshotQueue(const SnapshotQueue &) = delete;
+    SnapshotQueue &operator=(const SnapshotQueue &) = delete;
+
+    // queue Q after `iteration` steps, with the residual history if given
+    void submit(const FlowState &Q, int iteration, const std::vector<ResidualNorms> *history = nullptr);
+
+    // block until every submitted snapshot is written; false if a write failed
+    bool wait();
+
+    // getter methods, valid after wait()
+    int getWritten() const { return written; }
+    int getDropped() const { return dropped; }
+
+private:
+    void writerLoop();
+
+    std::function<bool(const Snapshot &)> write;
+    Snapshot buffers[2];
+    int ready = -1;   // buffer waiting to be written
+    int writing = -1; // buffer the thread is writing
+    bool stop = false;
+    bool ok = true;   // false once a write failed
+    int written = 0;  // snapshots completed
+    int dropped = 0;  // snapshots replaced before being written
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+};
+
+#endif  // SNAPSHOTQUEUE_H
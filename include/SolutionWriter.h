@@ -0,0 +1,58 @@
+#ifndef SOLUTIONWRITER_H
+#define SOLUTIONWRITER_H
+
+#include <string>
+#include <vector>
+#include "FlowState.h"
+#include "GridHandler.h"
+#include "SnapshotQueue.h"
+
+// Solution output controls
+struct OutputOptions {
+    bool enabled = false;    // write solution files at all
+    int interval = 0;        // iterations (multigrid: cycles) between outputs (0 = final only)
+    int decimation = 1;      // keep every n-th grid line (cells are block-averaged)
+    bool vtk = true;         // binary VTK structured grid, <prefix>_<iteration>.vts
+    bool tecplot = false;    // Tecplot ASCII block format, <prefix>_<iteration>.dat
+    std::string prefix = "solution";
+};
+
+// Streams cell-centred Q and the derived P, T, u, v to VTK and/or Tecplot
+// files from a background I/O thread. The solver only pays for copying Q
+// into a snapshot buffer; derived fields, decimation and formatting all
+// happen on the writer thread.
+class SolutionWriter {
+public:
+    // grid must already be halo-extended; R and gamma give P and T from Q
+    SolutionWriter(const GridHandler &grid, double R, double gamma, const OutputOptions &options);
+
+    // queue the state after `iteration` steps
+    void submit(const FlowState &Q, int iteration) { queue.submit(Q, iteration); }
+
+    // block until every submitted snapshot is written; false if a write failed
+    bool wait() { return queue.wait(); }
+
+    // file the snapshot after `iteration` steps goes to, e.g. ".vts"
+    std::string fileName(int iteration, const char *extension) const;
+
+    // getter methods
+    const OutputOptions &getOptions() const { return options; }
+    int getWritten() const { return queue.getWritten(); } // valid after wait()
+    int getDropped() const { return queue.getDropped(); }
+
+private:
+    // interior cells averaged over each output cell, one plane per field
+    void sampleFields(const FlowState &Q, std::vector<float> &fields) const;
+
+    bool writeSnapshot(const Snapshot &s) const;
+    bool writeVTK(const std::string &filename, const std::vector<float> &fields) const;
+    bool writeTecplot(const std::string &filename, const std::vector<float> &fields, int iteration) const;
+
+    OutputOptions options;
+    double R, gamma;
+    std::vector<int> lineI, lineJ;  // interior node lines kept (halo-extended indices)
+    std::vector<float> pointX, pointY; // kept nodes, i fastest
+    SnapshotQueue queue;            // last, so it drains before the rest goes away
+};
+
+#endif  // SOLUTIONWRITER_H
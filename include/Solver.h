@@ -0,0 +1,189 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "BlockCoupling.h"
+#include "FlowState.h"
+#include "FluxSolver.h"
+#include "GridHandler.h"
+#include "Initialize.h"
+#include "LUSGS.h"
+#include "Profiler.h"
+#include "ResidualMonitor.h"
+#include "SolutionWriter.h"
+
+// Pseudo-time integration schemes
+enum class TimeScheme {
+    ForwardEuler, // explicit, CFL below ~1 (0.3 with MUSCL)
+    LUSGS,        // implicit LU-SGS, CFL in the hundreds
+    RungeKutta    // explicit multi-stage (SolverOptions::stages), CFL up to ~3.5
+};
+
+// Low-storage multi-stage schemes for TimeScheme::RungeKutta. Stage m sets
+// Q_m = a_m Q_0 + (1 - a_m) Q_m-1 - b_m dt / V R(Q_m-1) with the dt of Q_0,
+// so Q_0 is the only extra copy of the state (2N storage). Largest CFL that
+// converged on the wedge with first-order fluxes (forward Euler: 1.0):
+// Jameson4/5 and SSP3 1.2, Upwind3 2.0, Upwind4 2.8, Upwind5 3.6. With
+// MUSCL fluxes (any limiter): forward Euler 0.3, Jameson4/5, SSP3 and
+// Upwind3 1.2, Upwind4 1.8, Upwind5 2.0; the Solver lowers a larger cfl.
+// Multigrid with MUSCL Upwind4 converges up to 1.2 (slowly at 1.5).
+enum class StageScheme {
+    Jameson4, // a = 1, b = 1/4, 1/3, 1/2, 1 (classic four-stage, for central fluxes)
+    Jameson5, // a = 1, b = 1/4, 1/6, 3/8, 1/2, 1 (five-stage, for central fluxes)
+    Upwind3,  // a = 1, b = 0.1481, 0.4, 1 (damping optimized for first-order upwind, van Leer et al.)
+    Upwind4,  // a = 1, b = 0.0833, 0.2069, 0.4265, 1
+    Upwind5,  // a = 1, b = 0.0533, 0.1263, 0.2375, 0.4414, 1
+    SSP3      // a = 1, 3/4, 1/3, b = 1, 1/4, 2/3 (Shu-Osher TVD RK3)
+};
+
+// Pseudo-time marching controls
+struct SolverOptions {
+    TimeScheme scheme = TimeScheme::ForwardEuler;
+    StageScheme stages = StageScheme::Upwind4; // TimeScheme::RungeKutta coefficients
+    Reconstruction reconstruction = Reconstruction::FirstOrder; // MUSCL: second-order face states (explicit
+                                                                // schemes need a smaller cfl, see StageScheme)
+    Limiter limiter = Limiter::VanAlbada; // MUSCL slope limiter (van Leer may stall under multigrid)
+    double cfl = 0.8;            // Courant number
+    bool localTimeStep = true;   // per-cell dt instead of the global minimum
+    int maxIterations = 20000;   // hard cap on pseudo-time steps
+    double tolerance = 1e-10;    // relative L2 drop that counts as converged
+    int stallWindow = 2000;      // iterations allowed without stallRatio progress (0 = off)
+    double stallRatio = 0.5;     // reduction expected within each stallWindow
+    int printInterval = 500;     // iterations between convergence lines (0 = quiet)
+    int jacobianInterval = 4;    // LU-SGS: iterations between Jacobian rebuilds
+    int tileNI = 256;            // cells per tile in i for the threaded sweeps (0 = all)
+    int tileNJ = 16;             // cells per tile in j
+    int checkpointInterval = 0;  // iterations between background checkpoints (0 = off)
+    std::string checkpointFile = "checkpoint.ckpt"; // written by run() and Multigrid::run()
+    OutputOptions output;        // VTK/Tecplot solution files from run() and Multigrid::run()
+    ProfileOptions profile;      // profile lines and end-of-run report (with Profiler enabled)
+    Precision precision = Precision::Double; // Mixed: float Q, R, dt and metrics (explicit schemes only)
+    bool fusedSweep = false;     // one cache-blocked pass per step (forward Euler, local dt, first order,
+                                 // single block)
+    int temporalSteps = 1;       // fused: pseudo-time steps per pass over each tile
+    bool freezeSettled = false;  // skip tiles whose residual has settled (forward Euler, local dt, single grid;
+                                 // smaller tiles freeze more of the domain)
+    double freezeRatio = 0.1;    // settled: every |R| in the tile below freezeRatio * tolerance * reference L2
+};
+
+// Pseudo-time driver marching Q to steady state with a CFL-limited local or
+// global time step, explicitly (forward Euler or a multi-stage Runge-Kutta
+// scheme) or implicitly (LU-SGS).
+class Solver {
+public:
+    // grid must already be halo-extended, init must hold the initial state
+    Solver(const GridHandler &grid, Initialize &init, const SolverOptions &options);
+
+    // implicit keeps a reference to flux, so a Solver stays where it was built
+    Solver(const Solver &) = delete;
+    Solver &operator=(const Solver &) = delete;
+
+    // dt per cell from the convective spectral radii of the xi and eta faces,
+    // only on the tiles t with (*active)[t] != 0 if active is given
+    void computeTimeStep(const std::vector<unsigned char> *active = nullptr);
+
+    // one pseudo-time step: BCs, residual, norms, update; returns the norms.
+    // A fused sweep with temporalSteps > 1 takes that many steps at once and
+    // records the norms of each; getResidual() and getTimeStep() are not
+    // filled by fused steps.
+    const ResidualNorms &iterate();
+
+    // BCs and residual R(Q) - forcing for the current Q, without updating it
+    const FlowState &evaluateResidual();
+
+    // source subtracted from the residual (FAS coarse-grid forcing); nullptr = none
+    void setForcing(const FlowState *P) { forcing = P; }
+
+    // neighbours of this block in a multi-block run (not owned); nullptr = single block
+    void setCoupling(BlockCoupling *c) { coupling = c; }
+
+    // march until converged, stalled or maxIterations; true if converged.
+    // Iterations continue from the restored count after restart().
+    bool run();
+
+    // Precision::Mixed marches a float copy of Q; this copies it back into
+    // init's state (run() does so before every checkpoint, output and return)
+    void syncState();
+
+    // load Q (and, on the same grid, the residual history) from a checkpoint
+    bool restart(const std::string &filename);
+
+    // start from Q0 (e.g. a converged neighbouring case on the same grid)
+    // instead of the current initial conditions. Convergence is still judged
+    // against the residual of the initial conditions, as in a cold start.
+    bool warmStart(const FlowState &Q0);
+
+    // getter methods
+    const SolverOptions &getOptions() const { return options; }
+    const ResidualMonitor &getMonitor() const { return monitor; }
+    ResidualMonitor &getMonitor() { return monitor; }
+    Initialize &getInit() { return init; }
+    const FlowState &getResidual() const { return residual; }
+    const FluxSolver &getFlux() const { return flux; }
+    const AlignedVector<double> &getTimeStep() const { return dt; }
+    const AlignedVector<double> &getInvVolume() const { return invVolume; }
+    // residual sweeps per iterate() (the stages of TimeScheme::RungeKutta, else 1)
+    int getStageCount() const;
+    // share of the interior cells updated by the last step (below 1 with freezeSettled)
+    double getActiveFraction() const { return activeFraction; }
+
+private:
+    // Precision::Mixed storage, swept instead of init's state and the
+    // double residual, dt and 1 / V
+    struct SinglePrecision {
+        FlowStateF Q;
+        FlowStateF next; // fused sweep target
+        FlowStateF start; // multi-stage Q_0
+        FlowStateF residual;
+        AlignedVector<float> dt;
+        AlignedVector<float> invVolume;
+    };
+
+    template <typename Real>
+    void timeStep(const BasicFlowState<Real> &Q, const BasicFaceMetrics<Real> &xi,
+                  const BasicFaceMetrics<Real> &eta, const AlignedVector<Real> &iVol,
+                  AlignedVector<Real> &dtField, const std::vector<unsigned char> *active);
+    template <typename Real>
+    void update(BasicFlowState<Real> &Q, const BasicFlowState<Real> &R,
+                const AlignedVector<Real> &dtField, const AlignedVector<Real> &iVol,
+                const std::vector<unsigned char> *active = nullptr);
+    const ResidualNorms &iterateMixed();
+    const ResidualNorms &iterateStages();
+    const ResidualNorms &recordNorms();
+    template <typename Real>
+    void stageUpdate(BasicFlowState<Real> &Q, BasicFlowState<Real> &Q0, const BasicFlowState<Real> &R,
+                     const AlignedVector<Real> &dtField, const AlignedVector<Real> &iVol,
+                     bool first, double a, double b);
+    template <typename Real>
+    const ResidualNorms &iterateFused(BasicFlowState<Real> &Q, BasicFlowState<Real> &next,
+                                      const AlignedVector<Real> &iVol);
+    template <typename Real>
+    const ResidualNorms &iterateActive(BasicFlowState<Real> &Q, BasicFlowState<Real> &R,
+                                       const AlignedVector<Real> &iVol);
+    // norms of the interior from per-tile sums, added in tile order
+    const ResidualNorms &recordTileSums(const ResidualNorms *sums, std::size_t tiles, double nCells);
+
+    const GridHandler &grid;
+    Initialize &init;
+    SolverOptions options;
+    FluxSolver flux;
+    ResidualMonitor monitor;
+    const FlowState *forcing = nullptr; // optional forcing term, not owned
+    BlockCoupling *coupling = nullptr;  // inter-block halo exchange, not owned
+    FlowState residual;             // flux balance R per cell
+    AlignedVector<double> dt;       // pseudo-time step per cell, padded like FlowState
+    AlignedVector<double> invVolume; // 1 / cell volume, padded like FlowState
+    std::vector<double> tileMin;    // per-tile dt minima
+    FlowState next;                 // fused sweep target, swapped with the state
+    FlowState start;                // multi-stage Q_0
+    std::vector<ResidualNorms> tileSums; // residual sums per tile (fused: per step and tile)
+    std::vector<unsigned char> updated;   // freezeSettled: tiles updated by the last step
+    std::vector<unsigned char> evaluated; // freezeSettled: tiles whose residual is recomputed
+    double activeFraction = 1.0;
+    std::unique_ptr<LUSGS> implicit; // only for TimeScheme::LUSGS
+    std::unique_ptr<SinglePrecision> single; // only for Precision::Mixed
+};
+
+#endif  // SOLVER_H
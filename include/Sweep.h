@@ -0,0 +1,107 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FlowState.h"
+#include "GridHandler.h"
+#include "Multigrid.h"
+#include "Solver.h"
+
+// One case of a parametric sweep: inlet state on a given grid
+struct SweepCase {
+    std::string name;
+    std::string grid; // grid file or generated grid spec; cases naming the same grid share it
+    double P = 0.0;   // [Pa] inlet pressure
+    double T = 0.0;   // [K] inlet temperature
+    double M = 0.0;   // inlet Mach number
+};
+
+// Outcome of one case
+struct SweepResult {
+    std::string name;
+    bool converged = false;
+    int iterations = 0;      // iterations (multigrid: cycles) of the final attempt
+    double seconds = 0.0;    // wall time of the case, retries included
+    double relativeL2 = 0.0; // final relative residual
+    std::string warmStart;   // case it was started from (empty = cold start)
+};
+
+// Sweep controls
+struct SweepOptions {
+    int workers = 1;              // cases solved at once
+    int threadsPerCase = 1;       // OpenMP threads inside each case
+    bool useMultigrid = true;     // FAS multigrid (false = single grid Solver)
+    MultigridOptions multigrid;
+    bool warmStart = true;        // start from the nearest converged case
+    double warmStartRadius = 0.05; // largest relative Mach number difference to a usable neighbour
+    std::string summary;          // CSV of the results (empty = none)
+};
+
+// Reads a case list, one case per line: name grid P T M ('#' starts a comment).
+// grid is a grid file or a generated grid spec such as wedge:ni=1281,nj=129.
+bool readCaseList(const std::string &filename, std::vector<SweepCase> &cases);
+
+// Runs a list of cases on a pool of worker threads. Every grid file is read
+// (or loaded from its cache) and given metrics and multigrid levels once; the
+// cases on it share them read-only and only own their state and solver.
+// Cases are sorted by grid and inlet state and dealt out in contiguous runs,
+// so a worker usually warm-starts from the case it just finished; idle workers
+// steal from the far end of the longest remaining run.
+//
+// A warm start takes the converged case on the same grid with the nearest
+// Mach number and rescales its density, velocity and pressure by the ratios
+// of the two inlet states. Inviscid solutions at the same Mach number differ
+// only by that scaling, so P and T do not count towards the distance. A warm
+// start that does not converge is retried from the initial conditions.
+class Sweep {
+public:
+    Sweep(double R, double gamma, double Cp,
+          const SolverOptions &solverOptions,
+          const SweepOptions &options);
+
+    Sweep(const Sweep &) = delete;
+    Sweep &operator=(const Sweep &) = delete;
+
+    // solve every case; true if all converged. Results are in case order.
+    bool run(const std::vector<SweepCase> &cases);
+
+    // getter methods
+    const std::vector<SweepResult> &getResults() const { return results; }
+
+private:
+    // a grid and its multigrid levels, shared by all cases on it
+    struct SharedGrid {
+        std::string file;
+        GridHandler grid;
+        std::vector<std::unique_ptr<GridHandler>> coarse;
+    };
+
+    // converged state of a finished case, for warm starts
+    struct Solution {
+        int index;                      // case index
+        std::shared_ptr<FlowState> Q;
+    };
+
+    bool loadGrids(const std::vector<SweepCase> &cases);
+    void solveCase(int index);
+    bool attempt(const SweepCase &c, const SharedGrid &shared, Initialize &init,
+                 const FlowState *Q0, SweepResult &result) const;
+    const Solution *nearestSolution(int index) const; // solutionsMutex held
+    bool writeSummary() const;
+
+    double R, gamma, Cp;
+    SolverOptions solverOptions;
+    SweepOptions options;
+    std::vector<SweepCase> cases;
+    std::vector<SweepResult> results;
+    std::vector<int> gridOf;                          // shared grid of each case
+    std::vector<std::unique_ptr<SharedGrid>> grids;
+    std::vector<Solution> solutions;                  // guarded by solutionsMutex
+    mutable std::mutex solutionsMutex;
+    std::mutex printMutex;
+};
+
+#endif  // SWEEP_H
@@ -0,0 +1,651 @@
+#include "AdaptiveMesh.h"
+#include "Checkpoint.h"
+#include "SolutionWriter.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+// box [iBegin, iEnd) x [jBegin, jEnd) of base cells
+struct Box {
+    int iBegin, iEnd, jBegin, jEnd;
+    bool operator==(const Box &) const = default;
+};
+
+// VTK multiblock index of the base and patch files, named relative to it
+bool writeIndex(const std::string &filename, const std::vector<std::string> &files) {
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    file << "<?xml version=\"1.0\"?>\n"
+         << "<VTKFile type=\"vtkMultiBlockDataSet\" version=\"1.0\">\n"
+         << "  <vtkMultiBlockDataSet>\n";
+    for (std::size_t n = 0; n < files.size(); ++n) {
+        file << "    <DataSet index=\"" << n << "\" name=\"" << (n == 0 ? "base" : "patch " + std::to_string(n - 1))
+             << "\" file=\"" << std::filesystem::path(files[n]).filename().string() << "\"/>\n";
+    }
+    file << "  </vtkMultiBlockDataSet>\n"
+         << "</VTKFile>\n";
+    if (!file) {
+        std::cerr << "Failed to write solution: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+AdaptiveMesh::AdaptiveMesh(const GridHandler &grid_, Initialize &init_,
+                           const SolverOptions &solverOptions,
+                           const AdaptiveOptions &options_)
+  : grid(grid_), init(init_), options(options_), levelOptions(solverOptions),
+    monitor(solverOptions.tolerance, solverOptions.stallWindow, solverOptions.stallRatio)
+{
+    options.ratio = std::max(options.ratio, 2);
+    options.blockSize = std::max(options.blockSize, 1);
+    options.buffer = std::max(options.buffer, 0);
+    options.fineSteps = std::max(options.fineSteps, 1);
+    options.keepRegrids = std::max(options.keepRegrids, 1);
+
+    // the interface fluxes are formed in double, and the forcing and the
+    // patch ghosts change between the steps
+    levelOptions.precision = Precision::Double;
+    levelOptions.fusedSweep = false;
+    levelOptions.temporalSteps = 1;
+    levelOptions.freezeSettled = false;
+
+    base = std::make_unique<Solver>(grid, init, levelOptions);
+    const FlowState &Q = init.getState();
+    correction.resize(Q.getNI(), Q.getNJ());
+    owner.assign(static_cast<std::size_t>(Q.getNI()) * Q.getNJ(), -1);
+    base->setForcing(&correction);
+
+    // interpolation slopes measure jumps against the freestream like the
+    // MUSCL fluxes, with the momentum magnitude for both components
+    const std::array<double, 4> &Qinf = init.getFreestream();
+    const double scale[4] = {Qinf[0], std::hypot(Qinf[1], Qinf[2]), std::hypot(Qinf[1], Qinf[2]), Qinf[3]};
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        jumpScale2[k] = smoothJump * smoothJump * scale[k] * scale[k] + 1e-300;
+    }
+}
+
+AdaptiveMesh::~AdaptiveMesh() = default;
+
+ResidualNorms AdaptiveMesh::Patch::reduceNorms(const ResidualNorms &sums, double cells) {
+    // the patch's own norms; the composite ones are formed by AdaptiveMesh
+    ResidualNorms norms = sums;
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        norms.L2[k] = std::sqrt(sums.L2[k] / cells);
+    }
+    return norms;
+}
+
+long long AdaptiveMesh::getBaseCells() const {
+    return static_cast<long long>(grid.getCellNX() - 2) * (grid.getCellNY() - 2);
+}
+
+long long AdaptiveMesh::getFineCells() const {
+    long long cells = 0;
+    for (const auto &patch : patches) {
+        cells += static_cast<long long>(patch->grid.getCellNX() - 2) * (patch->grid.getCellNY() - 2);
+    }
+    return cells;
+}
+
+long long AdaptiveMesh::getCompositeCells() const {
+    long long covered = 0;
+    for (const auto &patch : patches) {
+        covered += static_cast<long long>(patch->iEnd - patch->iBegin) * (patch->jEnd - patch->jBegin);
+    }
+    return getBaseCells() - covered + getFineCells();
+}
+
+void AdaptiveMesh::interpolate(int ci, int cj, double dx, double dy, double q[4]) const {
+    // linear in the base cell with the van Albada slopes of the fluxes, so
+    // the children of a cell average to it; like those slopes it is not TVD
+    // (small jumps are hardly limited) and may overshoot a neighbour a little
+    const FlowState &Q = init.getState();
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        const double c = Q(k, ci, cj);
+        const double eps2 = std::max(jumpScale2[k], smoothJump * smoothJump * c * c);
+        const double sx = limitedSlope<Limiter::VanAlbada>(Q(k, ci + 1, cj) - c, c - Q(k, ci - 1, cj), eps2);
+        const double sy = limitedSlope<Limiter::VanAlbada>(Q(k, ci, cj + 1) - c, c - Q(k, ci, cj - 1), eps2);
+        q[k] = c + sx * dx + sy * dy;
+    }
+}
+
+void AdaptiveMesh::fillGhosts(const Patch &patch, FlowState &Q) const {
+    ScopedTimer timer(Phase::Boundary);
+    for (const Ghost &g : patch.ghosts) {
+        if (g.source) {
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                Q(k, g.i, g.j) = (*g.source)(k, g.si, g.sj);
+            }
+        } else {
+            double q[4];
+            interpolate(g.si, g.sj, g.dx, g.dy, q);
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                Q(k, g.i, g.j) = q[k];
+            }
+        }
+    }
+}
+
+void AdaptiveMesh::flagCells(std::vector<unsigned char> &flags) const {
+    const FlowState &Q = init.getState();
+    const int ni = Q.getNI();
+    const int nj = Q.getNJ();
+    const double g1 = init.getGamma() - 1.0;
+    auto pressure = [&](int i, int j) {
+        const double rho = Q(0, i, j);
+        const double u = Q(1, i, j) / rho;
+        const double v = Q(2, i, j) / rho;
+        return g1 * (Q(3, i, j) - 0.5 * rho * (u * u + v * v));
+    };
+
+    // relative pressure jump across the cell in xi and eta: about 1/3 in a
+    // captured shock, a few percent in an expansion fan. Refined cells stay
+    // flagged down to half the threshold, so the layout does not flicker.
+    std::vector<unsigned char> sensed(flags.size(), 0);
+    parallelFor(1, nj - 1, [&](int j) {
+        for (int i = 1; i < ni - 1; ++i) {
+            const double pw = pressure(i - 1, j), pe = pressure(i + 1, j);
+            const double ps = pressure(i, j - 1), pn = pressure(i, j + 1);
+            const double s = std::max(std::fabs(pe - pw) / (pe + pw), std::fabs(pn - ps) / (pn + ps));
+            const std::size_t c = static_cast<std::size_t>(j) * ni + i;
+            const double limit = owner[c] >= 0 ? 0.5 * options.threshold : options.threshold;
+            sensed[c] = s > limit;
+        }
+    });
+
+    // buffer of flagged cells around every sensed one
+    const int b = options.buffer;
+    std::vector<unsigned char> rows(flags.size(), 0);
+    parallelFor(1, nj - 1, [&](int j) {
+        for (int i = 1; i < ni - 1; ++i) {
+            for (int n = std::max(i - b, 1); n <= std::min(i + b, ni - 2); ++n) {
+                rows[static_cast<std::size_t>(j) * ni + i] |= sensed[static_cast<std::size_t>(j) * ni + n];
+            }
+        }
+    });
+    std::fill(flags.begin(), flags.end(), 0);
+    parallelFor(1, nj - 1, [&](int j) {
+        for (int i = 1; i < ni - 1; ++i) {
+            for (int n = std::max(j - b, 1); n <= std::min(j + b, nj - 2); ++n) {
+                flags[static_cast<std::size_t>(j) * ni + i] |= rows[static_cast<std::size_t>(n) * ni + i];
+            }
+        }
+    });
+}
+
+bool AdaptiveMesh::regrid() {
+    ScopedTimer timer(Phase::CellMetrics);
+    FlowState &Q = init.getState();
+    const int ni = Q.getNI();
+    const int nj = Q.getNJ();
+    const int r = options.ratio;
+    const int B = options.blockSize;
+    init.applyBoundaryConditions();
+
+    std::vector<unsigned char> flags(static_cast<std::size_t>(ni) * nj, 0);
+    flagCells(flags);
+
+    // blocks holding a flagged cell, merged along i into one patch per run.
+    // A refined block stays until it has gone unflagged for keepRegrids
+    // regrids in a row, and a block refined a second time stays for good:
+    // refining a block can take its sensor below the threshold, and
+    // dropping and refining it in turn restarts the convergence every time.
+    const int blocksI = (ni - 2 + B - 1) / B;
+    const int blocksJ = (nj - 2 + B - 1) / B;
+    unflagged.resize(static_cast<std::size_t>(blocksI) * blocksJ, 0);
+    dropped.resize(unflagged.size(), 0);
+    std::vector<Box> boxes;
+    for (int bj = 0; bj < blocksJ; ++bj) {
+        const int jBegin = 1 + bj * B;
+        const int jEnd = std::min(jBegin + B, nj - 1);
+        int runStart = -1;
+        for (int bi = 0; bi <= blocksI; ++bi) {
+            bool flagged = false;
+            if (bi < blocksI) {
+                const int iBegin = 1 + bi * B;
+                const int iEnd = std::min(iBegin + B, ni - 1);
+                for (int j = jBegin; j < jEnd && !flagged; ++j) {
+                    for (int i = iBegin; i < iEnd && !flagged; ++i) {
+                        flagged = flags[static_cast<std::size_t>(j) * ni + i] != 0;
+                    }
+                }
+                const std::size_t block = static_cast<std::size_t>(bj) * blocksI + bi;
+                const bool refined = owner[static_cast<std::size_t>(jBegin) * ni + iBegin] >= 0;
+                unflagged[block] = flagged || !refined ? 0 : unflagged[block] + 1;
+                const bool keep = refined && (dropped[block] || unflagged[block] < options.keepRegrids);
+                dropped[block] |= refined && !flagged && !keep;
+                flagged = flagged || keep;
+            }
+            if (flagged && runStart < 0) {
+                runStart = bi;
+            } else if (!flagged && runStart >= 0) {
+                boxes.push_back(Box{1 + runStart * B, std::min(1 + bi * B, ni - 1), jBegin, jEnd});
+                runStart = -1;
+            }
+        }
+    }
+
+    bool same = boxes.size() == patches.size();
+    for (std::size_t n = 0; same && n < boxes.size(); ++n) {
+        const Patch &p = *patches[n];
+        same = boxes[n] == Box{p.iBegin, p.iEnd, p.jBegin, p.jEnd};
+    }
+    if (same) {
+        return false;
+    }
+
+    // new patches start from the fine cells of the old ones where they
+    // overlap, elsewhere from the base level
+    const std::array<BoundaryType, 4> &types = init.getBoundaryTypes();
+    std::vector<std::unique_ptr<Patch>> built;
+    built.reserve(boxes.size());
+    for (const Box &box : boxes) {
+        auto patch = std::make_unique<Patch>();
+        patch->iBegin = box.iBegin;
+        patch->iEnd = box.iEnd;
+        patch->jBegin = box.jBegin;
+        patch->jEnd = box.jEnd;
+        patch->mesh = this;
+        if (!patch->grid.refineBlock(grid, box.iBegin, box.iEnd, box.jBegin, box.jEnd, r)) {
+            return false;
+        }
+        patch->init = std::make_unique<Initialize>(patch->grid, init.getR(), init.getGamma(), init.getCp());
+        patch->init->setFreestream(init.getFreestream());
+        patch->init->setBoundaryTypes({
+            box.iBegin == 1 ? types[WEST] : BoundaryType::InterBlock,
+            box.iEnd == ni - 1 ? types[EAST] : BoundaryType::InterBlock,
+            box.jBegin == 1 ? types[SOUTH] : BoundaryType::InterBlock,
+            box.jEnd == nj - 1 ? types[NORTH] : BoundaryType::InterBlock,
+        });
+
+        FlowState &Qf = patch->init->getState();
+        parallelFor(1, Qf.getNJ() - 1, [&](int q) {
+            const int cj = box.jBegin + (q - 1) / r;
+            const double dy = ((q - 1) % r + 0.5) / r - 0.5;
+            for (int p = 1; p < Qf.getNI() - 1; ++p) {
+                const int ci = box.iBegin + (p - 1) / r;
+                const int o = owner[static_cast<std::size_t>(cj) * ni + ci];
+                if (o >= 0) {
+                    const Patch &old = *patches[o];
+                    const FlowState &Qo = old.init->getState();
+                    const int po = p + (box.iBegin - old.iBegin) * r;
+                    const int qo = q + (box.jBegin - old.jBegin) * r;
+                    for (int k = 0; k < FlowState::NVAR; ++k) {
+                        Qf(k, p, q) = Qo(k, po, qo);
+                    }
+                } else {
+                    double v[4];
+                    interpolate(ci, cj, ((p - 1) % r + 0.5) / r - 0.5, dy, v);
+                    for (int k = 0; k < FlowState::NVAR; ++k) {
+                        Qf(k, p, q) = v[k];
+                    }
+                }
+            }
+        });
+        patch->solver = std::make_unique<Solver>(patch->grid, *patch->init, levelOptions);
+        patch->solver->setCoupling(patch.get());
+        if (levelOptions.output.enabled) {
+            OutputOptions patchOutput = levelOptions.output;
+            std::string index = std::to_string(built.size());
+            index.insert(0, index.size() < 3 ? 3 - index.size() : 0, '0');
+            patchOutput.prefix += "_p" + index;
+            patch->output = std::make_unique<SolutionWriter>(patch->grid, init.getR(), init.getGamma(), patchOutput);
+        }
+        built.push_back(std::move(patch));
+    }
+    patches = std::move(built);
+
+    std::fill(owner.begin(), owner.end(), -1);
+    for (std::size_t n = 0; n < patches.size(); ++n) {
+        const Patch &p = *patches[n];
+        for (int j = p.jBegin; j < p.jEnd; ++j) {
+            std::fill_n(owner.begin() + static_cast<std::ptrdiff_t>(j) * ni + p.iBegin, p.iEnd - p.iBegin,
+                        static_cast<int>(n));
+        }
+    }
+    linkPatches();
+    correction.setZero();
+    return true;
+}
+
+void AdaptiveMesh::linkPatches() {
+    const int ni = init.getState().getNI();
+    const int r = options.ratio;
+
+    for (const auto &patch : patches) {
+        Patch &P = *patch;
+        const int np = P.grid.getCellNX();
+        const int nq = P.grid.getCellNY();
+        const std::array<BoundaryType, 4> &types = P.init->getBoundaryTypes();
+        P.ghosts.clear();
+        P.interfaces.clear();
+
+        // both ghost layers of the InterBlock sides (MUSCL reaches the second)
+        auto link = [&](int i, int j) {
+            const int fi = (P.iBegin - 1) * r + i; // fine cell index over the whole domain
+            const int fj = (P.jBegin - 1) * r + j;
+            const int ci = 1 + (fi - 1) / r;
+            const int cj = 1 + (fj - 1) / r;
+            const int o = owner[static_cast<std::size_t>(cj) * ni + ci];
+            if (o >= 0) {
+                const Patch &S = *patches[o];
+                P.ghosts.push_back(Ghost{i, j, &S.init->getState(),
+                                         fi - (S.iBegin - 1) * r, fj - (S.jBegin - 1) * r, 0.0, 0.0});
+            } else {
+                P.ghosts.push_back(Ghost{i, j, nullptr, ci, cj,
+                                         ((fi - 1) % r + 0.5) / r - 0.5, ((fj - 1) % r + 0.5) / r - 0.5});
+            }
+        };
+        for (int layer = 0; layer < 2; ++layer) {
+            for (int j = 1; j < nq - 1; ++j) {
+                if (types[WEST] == BoundaryType::InterBlock) {
+                    link(-layer, j);
+                }
+                if (types[EAST] == BoundaryType::InterBlock) {
+                    link(np - 1 + layer, j);
+                }
+            }
+            for (int i = 1; i < np - 1; ++i) {
+                if (types[SOUTH] == BoundaryType::InterBlock) {
+                    link(i, -layer);
+                }
+                if (types[NORTH] == BoundaryType::InterBlock) {
+                    link(i, nq - 1 + layer);
+                }
+            }
+        }
+
+        // coarse-fine faces: base cells outside the patch that no other patch covers
+        auto uncovered = [&](int ci, int cj) { return owner[static_cast<std::size_t>(cj) * ni + ci] < 0; };
+        for (int cj = P.jBegin; cj < P.jEnd; ++cj) {
+            const int first = (cj - P.jBegin) * r + 1;
+            if (types[WEST] == BoundaryType::InterBlock && uncovered(P.iBegin - 1, cj)) {
+                P.interfaces.push_back(Interface{P.iBegin - 1, cj, true, P.iBegin, 1, first, 1.0});
+            }
+            if (types[EAST] == BoundaryType::InterBlock && uncovered(P.iEnd, cj)) {
+                P.interfaces.push_back(Interface{P.iEnd, cj, true, P.iEnd, np - 1, first, -1.0});
+            }
+        }
+        for (int ci = P.iBegin; ci < P.iEnd; ++ci) {
+            const int first = (ci - P.iBegin) * r + 1;
+            if (types[SOUTH] == BoundaryType::InterBlock && uncovered(ci, P.jBegin - 1)) {
+                P.interfaces.push_back(Interface{ci, P.jBegin - 1, false, P.jBegin, 1, first, 1.0});
+            }
+            if (types[NORTH] == BoundaryType::InterBlock && uncovered(ci, P.jEnd)) {
+                P.interfaces.push_back(Interface{ci, P.jEnd, false, P.jEnd, nq - 1, first, -1.0});
+            }
+        }
+    }
+}
+
+void AdaptiveMesh::applyFluxCorrection() {
+    const FlowState &Q = init.getState();
+    const FluxSolver &coarseFlux = base->getFlux();
+    for (const auto &patch : patches) {
+        fillGhosts(*patch, patch->init->getState());
+    }
+
+    ScopedTimer timer(Phase::Update);
+    for (const auto &patch : patches) {
+        for (const Interface &f : patch->interfaces) {
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                correction(k, f.ci, f.cj) = 0.0;
+            }
+        }
+    }
+
+    // the base cell's flux through the interface is replaced by the sum of
+    // the fine fluxes through the same face: R - P uses the fine ones
+    for (const auto &patch : patches) {
+        const FlowState &Qf = patch->init->getState();
+        const FluxSolver &fineFlux = patch->solver->getFlux();
+        for (const Interface &f : patch->interfaces) {
+            double coarse[4], fine[4], sum[4] = {0.0, 0.0, 0.0, 0.0};
+            if (f.xiFace) {
+                coarseFlux.faceFlux(Q, true, f.face, f.cj, coarse);
+            } else {
+                coarseFlux.faceFlux(Q, false, f.ci, f.face, coarse);
+            }
+            for (int m = f.first; m < f.first + options.ratio; ++m) {
+                if (f.xiFace) {
+                    fineFlux.faceFlux(Qf, true, f.fine, m, fine);
+                } else {
+                    fineFlux.faceFlux(Qf, false, m, f.fine, fine);
+                }
+                for (int k = 0; k < FlowState::NVAR; ++k) {
+                    sum[k] += fine[k];
+                }
+            }
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                correction(k, f.ci, f.cj) += f.sign * (coarse[k] - sum[k]);
+            }
+        }
+    }
+
+    // covered base cells take their last residual into the forcing, so the
+    // base level leaves them to the restriction (an implicit sweep would
+    // otherwise carry their residual into the uncovered neighbours)
+    const FlowState &R = base->getResidual();
+    for (const auto &patch : patches) {
+        parallelFor(patch->jBegin, patch->jEnd, [&](int cj) {
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                for (int ci = patch->iBegin; ci < patch->iEnd; ++ci) {
+                    correction(k, ci, cj) += R(k, ci, cj);
+                }
+            }
+        });
+    }
+}
+
+void AdaptiveMesh::restrictToBase() {
+    ScopedTimer timer(Phase::Update);
+    FlowState &Q = init.getState();
+    const Eigen::MatrixXd &V = grid.getCellVolume();
+    const int r = options.ratio;
+
+    // volume-weighted average of the children
+    for (const auto &patch : patches) {
+        const FlowState &Qf = patch->init->getState();
+        const Eigen::MatrixXd &Vf = patch->grid.getCellVolume();
+        parallelFor(patch->jBegin, patch->jEnd, [&](int cj) {
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                for (int ci = patch->iBegin; ci < patch->iEnd; ++ci) {
+                    const int p0 = (ci - patch->iBegin) * r + 1;
+                    const int q0 = (cj - patch->jBegin) * r + 1;
+                    double sum = 0.0;
+                    for (int q = q0; q < q0 + r; ++q) {
+                        for (int p = p0; p < p0 + r; ++p) {
+                            sum += Vf(p, q) * Qf(k, p, q);
+                        }
+                    }
+                    Q(k, ci, cj) = sum / V(ci, cj);
+                }
+            }
+        });
+    }
+}
+
+const ResidualNorms &AdaptiveMesh::recordComposite() {
+    ScopedTimer timer(Phase::Norms);
+    ResidualNorms norms;
+    double cells = 0.0;
+    auto add = [&](const FlowState &R, int iBegin, int iEnd, int j, const int *covered) {
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            const double *Rk = R.row(k, j);
+            for (int i = iBegin; i < iEnd; ++i) {
+                if (!covered || covered[i] < 0) {
+                    norms.L2[k] += Rk[i] * Rk[i];
+                    norms.Linf[k] = std::max(norms.Linf[k], std::fabs(Rk[i]));
+                }
+            }
+        }
+    };
+
+    const FlowState &R = base->getResidual();
+    const int ni = R.getNI();
+    for (int j = 1; j < R.getNJ() - 1; ++j) {
+        add(R, 1, ni - 1, j, owner.data() + static_cast<std::ptrdiff_t>(j) * ni);
+    }
+    cells += static_cast<double>(getCompositeCells() - getFineCells());
+    for (const auto &patch : patches) {
+        const FlowState &Rf = patch->solver->getResidual();
+        for (int j = 1; j < Rf.getNJ() - 1; ++j) {
+            add(Rf, 1, Rf.getNI() - 1, j, nullptr);
+        }
+    }
+    cells += static_cast<double>(getFineCells());
+
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        norms.L2[k] = std::sqrt(norms.L2[k] / cells);
+    }
+    return monitor.record(norms);
+}
+
+const ResidualNorms &AdaptiveMesh::iterate() {
+    applyFluxCorrection();
+    base->iterate();
+    for (const auto &patch : patches) {
+        for (int n = 0; n < options.fineSteps; ++n) {
+            patch->solver->iterate();
+        }
+    }
+    restrictToBase();
+    return recordComposite();
+}
+
+bool AdaptiveMesh::run() {
+    const SolverOptions &solverOptions = levelOptions;
+    const int printInterval = solverOptions.printInterval;
+
+    // checkpoints and solution files of the base level (holding the averages
+    // of the patches) go to disk on background threads
+    std::unique_ptr<CheckpointWriter> checkpoint;
+    if (solverOptions.checkpointInterval > 0) {
+        checkpoint = std::make_unique<CheckpointWriter>(grid, solverOptions.checkpointFile, init.getGamma());
+    }
+    std::unique_ptr<SolutionWriter> output;
+    if (solverOptions.output.enabled) {
+        output = std::make_unique<SolutionWriter>(grid, init.getR(), init.getGamma(), solverOptions.output);
+    }
+    // the base level and every patch on its own grid, with a VTK index
+    auto submitOutput = [&]() {
+        const int iteration = monitor.getIterations();
+        output->submit(init.getState(), iteration);
+        std::vector<std::string> files{output->fileName(iteration, ".vts")};
+        for (const auto &patch : patches) {
+            patch->output->submit(patch->init->getState(), iteration);
+            files.push_back(patch->output->fileName(iteration, ".vts"));
+        }
+        if (solverOptions.output.vtk) {
+            writeIndex(output->fileName(iteration, ".vtm"), files);
+        }
+    };
+    auto finalOutput = [&]() {
+        if (!solverOptions.profile.report.empty()) {
+            Profiler::writeReport(solverOptions.profile.report);
+        }
+        if (checkpoint) {
+            checkpoint->submit(init.getState(), monitor.getIterations(), monitor.getHistory());
+        }
+        if (output) {
+            submitOutput();
+        }
+        if (checkpoint) {
+            checkpoint->wait();
+        }
+        if (output) {
+            output->wait();
+            for (const auto &patch : patches) {
+                patch->output->wait();
+            }
+        }
+    };
+
+    for (int n = monitor.getIterations(); n < solverOptions.maxIterations; ++n) {
+        if (n > 0 && options.regridInterval > 0 && n % options.regridInterval == 0) {
+            regrid();
+        }
+        const ResidualNorms &norms = iterate();
+        Profiler::countIteration();
+
+        if (printInterval > 0 && n % printInterval == 0) {
+            std::cout << "iter " << std::setw(6) << n
+                      << std::scientific << std::setprecision(4)
+                      << "  L2(rho) " << norms.L2[0]
+                      << "  rel " << monitor.relativeL2()
+                      << std::defaultfloat
+                      << "  patches " << getPatchCount()
+                      << "  cells " << getCompositeCells() << "\n";
+        }
+        if (Profiler::enabled() && solverOptions.profile.interval > 0 && n % solverOptions.profile.interval == 0) {
+            Profiler::printLine(std::cout, n);
+        }
+        if (monitor.converged()) {
+            // a shock that moved since the last regrid gets its patches first
+            if (regrid()) {
+                continue;
+            }
+            init.applyBoundaryConditions();
+            finalOutput();
+            std::cout << "Converged after " << monitor.getIterations() << " iterations on "
+                      << getPatchCount() << " patches (" << getCompositeCells() << " cells)\n";
+            return true;
+        }
+        if (monitor.diverged()) {
+            std::cerr << "Residual diverged after " << monitor.getIterations() << " iterations\n";
+            if (!solverOptions.profile.report.empty()) {
+                Profiler::writeReport(solverOptions.profile.report);
+            }
+            return false;
+        }
+        if (monitor.stalled()) {
+            init.applyBoundaryConditions();
+            finalOutput();
+            std::cout << "Residual stalled after " << monitor.getIterations() << " iterations\n";
+            return false;
+        }
+        if (checkpoint && monitor.getIterations() % solverOptions.checkpointInterval == 0) {
+            checkpoint->submit(init.getState(), monitor.getIterations(), monitor.getHistory());
+        }
+        if (output && solverOptions.output.interval > 0 && monitor.getIterations() % solverOptions.output.interval == 0) {
+            submitOutput();
+        }
+    }
+    init.applyBoundaryConditions();
+    finalOutput();
+    std::cout << "Reached " << solverOptions.maxIterations << " iterations without converging\n";
+    return false;
+}
+
+bool AdaptiveMesh::restart(const std::string &filename) {
+    CheckpointInfo info;
+    if (!readCheckpoint(filename, grid, init.getState(), info)) {
+        return false;
+    }
+    if (info.sameGrid) {
+        monitor.restore(info.history);
+    } else if (!info.history.empty()) {
+        // warm start on another grid: keep judging convergence against the
+        // cold start of the run that wrote the checkpoint
+        monitor.setReference(info.history.front());
+    }
+
+    // no patch covers a cell yet, so every fine cell comes from the base level
+    regrid();
+    init.applyBoundaryConditions();
+    return true;
+}
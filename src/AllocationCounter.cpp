@@ -0,0 +1,37 @@
+#include "Profiler.h"
+#include <cstdlib>
+#include <new>
+
+// Counting replacements of the global allocation functions, behind
+// Profiler::getAllocations(). They replace operator new for the whole
+// executable, so only the solver links this file (AllocationCounterLib);
+// the libraries and the other executables keep the standard allocator.
+// Eigen matrices come from malloc and are not counted.
+
+void *operator new(std::size_t size) {
+    Profiler::countAllocation(size);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    Profiler::countAllocation(size);
+    const std::size_t a = static_cast<std::size_t>(alignment);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+void *operator new[](std::size_t size, std::align_val_t alignment) { return ::operator new(size, alignment); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
@@ -0,0 +1,50 @@
+#include "BlockDecomposition.h"
+#include <iostream>
+#include <limits>
+
+BlockDecomposition::BlockDecomposition() : blocksI(0), blocksJ(0) { }
+
+BlockDecomposition::BlockDecomposition(int ni, int nj, int count) : blocksI(0), blocksJ(0) {
+    const int cellsI = ni - 2;
+    const int cellsJ = nj - 2;
+
+    // px * py = count with the shortest cuts: every i-cut is cellsJ long and
+    // every j-cut cellsI long
+    long bestCut = std::numeric_limits<long>::max();
+    for (int px = 1; px <= count; ++px) {
+        if (count % px != 0) {
+            continue;
+        }
+        const int py = count / px;
+        if (px > cellsI || py > cellsJ) {
+            continue;
+        }
+        const long cut = static_cast<long>(px - 1) * cellsJ + static_cast<long>(py - 1) * cellsI;
+        if (cut < bestCut) {
+            bestCut = cut;
+            blocksI = px;
+            blocksJ = py;
+        }
+    }
+    if (blocksI == 0) {
+        std::cerr << "Cannot split " << cellsI << " x " << cellsJ << " cells into " << count << " blocks.\n";
+        return;
+    }
+
+    blocks.reserve(count);
+    for (int b = 0; b < blocksJ; ++b) {
+        for (int a = 0; a < blocksI; ++a) {
+            Block block;
+            block.iBegin = 1 + static_cast<int>(static_cast<long>(a) * cellsI / blocksI);
+            block.iEnd = 1 + static_cast<int>(static_cast<long>(a + 1) * cellsI / blocksI);
+            block.jBegin = 1 + static_cast<int>(static_cast<long>(b) * cellsJ / blocksJ);
+            block.jEnd = 1 + static_cast<int>(static_cast<long>(b + 1) * cellsJ / blocksJ);
+            // west, east, south, north
+            block.neighbour[0] = a > 0 ? b * blocksI + a - 1 : -1;
+            block.neighbour[1] = a < blocksI - 1 ? b * blocksI + a + 1 : -1;
+            block.neighbour[2] = b > 0 ? (b - 1) * blocksI + a : -1;
+            block.neighbour[3] = b < blocksJ - 1 ? (b + 1) * blocksI + a : -1;
+            blocks.push_back(block);
+        }
+    }
+}
@@ -0,0 +1,207 @@
+#include "Checkpoint.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "MappedFile.h"
+#include "Parallel.h"
+
+namespace {
+
+constexpr char checkpointMagic[8] = "EULCKPT";
+constexpr std::uint32_t checkpointVersion = 1;
+constexpr std::uint32_t checkpointByteOrder = 0x01020304;
+
+static_assert(sizeof(CheckpointHeader) % sizeof(double) == 0, "payload must stay 8-byte aligned");
+static_assert(sizeof(ResidualNorms) == 2 * FlowState::NVAR * sizeof(double), "norms are stored as raw doubles");
+
+std::uint64_t fnv1a(std::uint64_t h, const void *bytes, std::size_t n) {
+    const unsigned char *p = static_cast<const unsigned char *>(bytes);
+    for (std::size_t k = 0; k < n; ++k) {
+        h ^= p[k];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// position of target cell c (interior, 0-based) of n cells on a source row of
+// m cells, as the lower source cell and the weight of the upper one
+void sourceCell(int c, int n, int m, int &lo, double &w) {
+    double t = (c + 0.5) * m / n - 0.5;
+    t = std::clamp(t, 0.0, static_cast<double>(m - 1));
+    lo = std::min(static_cast<int>(t), std::max(m - 2, 0));
+    w = m > 1 ? t - lo : 0.0;
+}
+
+} // namespace
+
+std::uint64_t gridHash(const GridHandler &grid) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    const std::int32_t dims[2] = {grid.getNX(), grid.getNY()};
+    h = fnv1a(h, dims, sizeof(dims));
+    h = fnv1a(h, grid.getX().data(), grid.getX().size() * sizeof(double));
+    h = fnv1a(h, grid.getY().data(), grid.getY().size() * sizeof(double));
+    return h;
+}
+
+CheckpointWriter::CheckpointWriter(const GridHandler &grid, const std::string &filename_, double gamma_)
+  : filename(filename_), gamma(gamma_), nodeNX(grid.getNX()), nodeNY(grid.getNY()),
+    hash(gridHash(grid)),
+    queue([this](const Snapshot &s) { return writeSnapshot(s); })
+{
+    nodes.resize(grid.getX().size() + grid.getY().size());
+    std::copy_n(grid.getX().data(), grid.getX().size(), nodes.begin());
+    std::copy_n(grid.getY().data(), grid.getY().size(), nodes.begin() + grid.getX().size());
+}
+
+bool CheckpointWriter::writeSnapshot(const Snapshot &s) const {
+    const FlowState &Q = s.Q;
+    CheckpointHeader header{};
+    std::copy(checkpointMagic, checkpointMagic + 8, header.magic);
+    header.version = checkpointVersion;
+    header.byteOrder = checkpointByteOrder;
+    header.nodeNX = nodeNX;
+    header.nodeNY = nodeNY;
+    header.ni = Q.getNI();
+    header.nj = Q.getNJ();
+    header.gridHash = hash;
+    header.iteration = s.iteration;
+    header.historyLength = static_cast<std::int64_t>(s.history.size());
+    header.gamma = gamma;
+
+    const std::string tmp = filename + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open file: " << tmp << "\n";
+            return false;
+        }
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(nodes.data()),
+                   static_cast<std::streamsize>(nodes.size() * sizeof(double)));
+        file.write(reinterpret_cast<const char *>(s.history.data()),
+                   static_cast<std::streamsize>(s.history.size() * sizeof(ResidualNorms)));
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            for (int j = 0; j < Q.getNJ(); ++j) {
+                file.write(reinterpret_cast<const char *>(Q.row(k, j)),
+                           static_cast<std::streamsize>(Q.getNI() * sizeof(double)));
+            }
+        }
+        if (!file) {
+            std::cerr << "Failed to write checkpoint: " << tmp << "\n";
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, filename, ec);
+    if (ec) {
+        std::cerr << "Failed to replace checkpoint " << filename << ": " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool readCheckpoint(const std::string &filename, const GridHandler &grid,
+                    FlowState &Q, CheckpointInfo &info) {
+    info = CheckpointInfo();
+    MappedFile file;
+    if (!file.open(filename)) {
+        return false;
+    }
+
+    CheckpointHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << "Checkpoint too short: " << filename << "\n";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (!std::equal(checkpointMagic, checkpointMagic + 8, header.magic) || header.version != checkpointVersion ||
+        header.byteOrder != checkpointByteOrder) {
+        std::cerr << "Not a compatible checkpoint: " << filename << "\n";
+        return false;
+    }
+
+    const std::size_t nodeCount = static_cast<std::size_t>(header.nodeNX) * header.nodeNY;
+    const std::size_t planeCount = static_cast<std::size_t>(header.ni) * header.nj;
+    const std::size_t expected = sizeof(header) + 2 * nodeCount * sizeof(double) +
+                                 static_cast<std::size_t>(header.historyLength) * sizeof(ResidualNorms) +
+                                 FlowState::NVAR * planeCount * sizeof(double);
+    if (header.nodeNX < 4 || header.nodeNY < 4 || header.ni != header.nodeNX - 1 ||
+        header.nj != header.nodeNY - 1 || header.historyLength < 0 || file.size() != expected) {
+        std::cerr << "Checkpoint " << filename << " is truncated or inconsistent\n";
+        return false;
+    }
+
+    // the payload is 8-byte aligned within the page-aligned mapping
+    const double *xs = reinterpret_cast<const double *>(file.data() + sizeof(header));
+    const double *ys = xs + nodeCount;
+    const ResidualNorms *norms = reinterpret_cast<const ResidualNorms *>(ys + nodeCount);
+    const double *planes = reinterpret_cast<const double *>(norms + header.historyLength);
+    info.iteration = static_cast<int>(header.iteration);
+    info.history.assign(norms, norms + header.historyLength);
+
+    const int ni = Q.getNI();
+    const int nj = Q.getNJ();
+    if (header.gridHash == gridHash(grid) && header.ni == ni && header.nj == nj) {
+        // same grid: exact restart
+        parallelFor(0, nj, [&](int j) {
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                std::copy_n(planes + k * planeCount + static_cast<std::size_t>(j) * ni, ni, Q.row(k, j));
+            }
+        });
+        info.sameGrid = true;
+        std::cout << "Restarted from " << filename << " at iteration " << header.iteration << "\n";
+        return true;
+    }
+
+    // different grid: it must span the same domain, checked on the corners of
+    // the node interior
+    const Eigen::MatrixXd &gx = grid.getX();
+    const Eigen::MatrixXd &gy = grid.getY();
+    const int ci[2] = {1, header.nodeNX - 2};
+    const int cj[2] = {1, header.nodeNY - 2};
+    const int gi[2] = {1, grid.getNX() - 2};
+    const int gj[2] = {1, grid.getNY() - 2};
+    const double diag = std::hypot(xs[ci[1] + static_cast<std::size_t>(cj[1]) * header.nodeNX] - xs[ci[0] + static_cast<std::size_t>(cj[0]) * header.nodeNX],
+                                   ys[ci[1] + static_cast<std::size_t>(cj[1]) * header.nodeNX] - ys[ci[0] + static_cast<std::size_t>(cj[0]) * header.nodeNX]);
+    for (int a = 0; a < 2; ++a) {
+        for (int b = 0; b < 2; ++b) {
+            const std::size_t c = ci[a] + static_cast<std::size_t>(cj[b]) * header.nodeNX;
+            if (std::hypot(xs[c] - gx(gi[a], gj[b]), ys[c] - gy(gi[a], gj[b])) > 1e-2 * diag) {
+                std::cerr << "Checkpoint " << filename << " was written on a grid of a different domain\n";
+                return false;
+            }
+        }
+    }
+
+    const int mI = header.ni - 2;
+    const int mJ = header.nj - 2;
+    const int nI = ni - 2;
+    const int nJ = nj - 2;
+    parallelFor(0, nJ, [&](int b) {
+        int j0;
+        double wj;
+        sourceCell(b, nJ, mJ, j0, wj);
+        const std::size_t row0 = static_cast<std::size_t>(j0 + 1) * header.ni;
+        const std::size_t row1 = static_cast<std::size_t>(std::min(j0 + 2, mJ)) * header.ni;
+        for (int a = 0; a < nI; ++a) {
+            int i0;
+            double wi;
+            sourceCell(a, nI, mI, i0, wi);
+            const int c0 = i0 + 1;
+            const int c1 = std::min(i0 + 2, mI);
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                const double *P = planes + k * planeCount;
+                const double lo = (1.0 - wi) * P[row0 + c0] + wi * P[row0 + c1];
+                const double hi = (1.0 - wi) * P[row1 + c0] + wi * P[row1 + c1];
+                Q.row(k, b + 1)[a + 1] = (1.0 - wj) * lo + wj * hi;
+            }
+        }
+    });
+    std::cout << "Interpolated " << header.ni - 2 << "x" << header.nj - 2 << " checkpoint " << filename
+              << " onto " << nI << "x" << nJ << " cells\n";
+    return true;
+}
@@ -0,0 +1,57 @@
+#include "FlowState.h"
+#include <algorithm>
+#include <type_traits>
+#include "Parallel.h"
+
+template <typename Real>
+BasicFlowState<Real>::BasicFlowState() : ni(0), nj(0), stride(0), planeSize(0) { }
+
+template <typename Real>
+BasicFlowState<Real>::BasicFlowState(int ni_, int nj_) : BasicFlowState() {
+    resize(ni_, nj_);
+}
+
+template <typename Real>
+void BasicFlowState<Real>::resize(int ni_, int nj_) {
+    ni = ni_;
+    nj = nj_;
+    // round rows up to whole cache lines so row(k, j) is always aligned,
+    // keeping the two second-layer ghost columns in the padding
+    stride = ((ni + 2 + PAD - 1) / PAD) * PAD;
+    planeSize = static_cast<std::size_t>(stride) * (nj + 2);
+    data.clear();
+    data.resize(NVAR * planeSize);
+    setZero();
+}
+
+template <typename Real>
+void BasicFlowState<Real>::setZero() {
+    parallelFor(-1, nj + 1, [&](int j) {
+        for (int k = 0; k < NVAR; ++k) {
+            std::fill_n(row(k, j), stride, Real(0));
+        }
+    });
+}
+
+template <typename Real>
+template <typename Other>
+void BasicFlowState<Real>::copyFrom(const BasicFlowState<Other> &other) {
+    // strides differ between precisions, so copy the used values per row,
+    // second ghost layer included (column -1 of row -1 is a corner, unused)
+    constexpr bool same = std::is_same_v<Real, Other>;
+    const int last = same ? stride : ni + 1;
+    parallelFor(-1, nj + 1, [&](int j) {
+        const int first = same || j < 0 ? 0 : -1;
+        for (int k = 0; k < NVAR; ++k) {
+            std::transform(other.row(k, j) + first, other.row(k, j) + last, row(k, j) + first,
+                           [](Other value) { return static_cast<Real>(value); });
+        }
+    });
+}
+
+template class BasicFlowState<double>;
+template class BasicFlowState<float>;
+template void BasicFlowState<double>::copyFrom(const BasicFlowState<double> &);
+template void BasicFlowState<double>::copyFrom(const BasicFlowState<float> &);
+template void BasicFlowState<float>::copyFrom(const BasicFlowState<double> &);
+template void BasicFlowState<float>::copyFrom(const BasicFlowState<float> &);
@@ -0,0 +1,628 @@
+#include "FluxSolver.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+// The row loops below are written so the compiler can vectorize them
+// (contiguous unit-stride loads, no branches). EULER_SIMD in CMakeLists.txt
+// picks the target ISA; without -fopenmp-simd the pragmas are simply ignored
+// and the same loops run as the scalar fallback.
+#if defined(_OPENMP) || defined(EULER_OMP_SIMD)
+#define EULER_PRAGMA_SIMD _Pragma("omp simd")
+#else
+#define EULER_PRAGMA_SIMD
+#endif
+
+namespace {
+
+// left and right states of the face between cells c and c+1 from the values
+// of cells c-1 .. c+2; floor2 is the freestream part of the limiter's eps2
+template <Limiter L>
+inline void faceStates(double wm, double w0, double w1, double w2, double floor2, double &left, double &right) {
+    const double d = w1 - w0;
+    const double s2 = smoothJump * smoothJump;
+    left = w0 + 0.5 * limitedSlope<L>(w0 - wm, d, std::max(floor2, s2 * w0 * w0));
+    right = w1 - 0.5 * limitedSlope<L>(d, w2 - w1, std::max(floor2, s2 * w1 * w1));
+}
+
+// split flux of one face from rho, u, v, P of the cells c-1 .. c+2 around it
+template <Limiter L>
+void faceFluxMUSCL(double gamma, const double (&w)[4][4], const double (&floor2)[4],
+                   double nx, double ny, double len, double f[4]) {
+    double left[4], right[4];
+    for (int k = 0; k < 4; ++k) {
+        faceStates<L>(w[0][k], w[1][k], w[2][k], w[3][k], floor2[k], left[k], right[k]);
+    }
+    splitFluxPrimitive(gamma, 1.0, left[0], left[1], left[2], left[3], nx, ny, len, f[0], f[1], f[2], f[3]);
+    splitFluxPrimitive(gamma, -1.0, right[0], right[1], right[2], right[3], nx, ny, len, f[0], f[1], f[2], f[3]);
+}
+
+} // namespace
+
+FluxSolver::FluxSolver(const GridHandler &grid, double gamma_, int tileNI, int tileNJ, Precision precision_,
+                       Reconstruction reconstruction_, Limiter limiter_)
+  : ni(grid.getCellNX()), nj(grid.getCellNY()), gamma(gamma_), precision(precision_),
+    reconstruction(reconstruction_), limiter(limiter_),
+    tiles(grid.getCellNX(), grid.getCellNY(), tileNI, tileNJ)
+{
+    stride = ((ni + 2 + FlowState::PAD - 1) / FlowState::PAD) * FlowState::PAD;
+
+    // repack the face area vectors into unit normals and lengths, row by row
+    // on the threads that will sweep those rows
+    auto pack = [&](auto &faces, const Eigen::MatrixXd &ax, const Eigen::MatrixXd &ay) {
+        using Real = typename std::remove_reference_t<decltype(faces.nx)>::value_type;
+        constexpr int pad = BasicFlowState<Real>::PAD;
+        faces.stride = ((ni + pad - 1) / pad) * pad;
+        const std::size_t plane = static_cast<std::size_t>(faces.stride) * nj;
+        faces.nx.resize(plane);
+        faces.ny.resize(plane);
+        faces.len.resize(plane);
+        parallelFor(0, nj, [&](int j) {
+            std::fill_n(faces.rowNX(j), faces.stride, Real(0));
+            std::fill_n(faces.rowNY(j), faces.stride, Real(0));
+            std::fill_n(faces.rowLen(j), faces.stride, Real(0));
+            // area matrices start at face index 1 in both directions
+            if (j < 1 || j > ax.cols()) {
+                return;
+            }
+            for (int i = 0; i < ax.rows(); ++i) {
+                const double len = std::hypot(ax(i, j - 1), ay(i, j - 1));
+                faces.rowLen(j)[i + 1] = static_cast<Real>(len);
+                faces.rowNX(j)[i + 1] = static_cast<Real>(len > 0.0 ? ax(i, j - 1) / len : 0.0);
+                faces.rowNY(j)[i + 1] = static_cast<Real>(len > 0.0 ? ay(i, j - 1) / len : 0.0);
+            }
+        });
+    };
+    if (precision == Precision::Mixed) {
+        pack(xiFacesF, grid.getXAreaXi(), grid.getYAreaXi());
+        pack(etaFacesF, grid.getXAreaEta(), grid.getYAreaEta());
+    } else {
+        pack(xiFaces, grid.getXAreaXi(), grid.getYAreaXi());
+        pack(etaFaces, grid.getXAreaEta(), grid.getYAreaEta());
+    }
+}
+
+void FluxSolver::setReferenceState(double rho, double speed, double P) {
+    const double scale[4] = {rho, speed, speed, P};
+    for (int k = 0; k < 4; ++k) {
+        jumpScale2[k] = smoothJump * smoothJump * scale[k] * scale[k] + 1e-300;
+    }
+}
+
+void FluxSolver::faceFlux(const FlowState &Q, bool xiFace, int i, int j, double f[4]) const {
+    const FaceMetrics &faces = xiFace ? xiFaces : etaFaces;
+    const double nx = faces.rowNX(j)[i];
+    const double ny = faces.rowNY(j)[i];
+    const double len = faces.rowLen(j)[i];
+    const int di = xiFace ? 1 : 0;
+    const int dj = xiFace ? 0 : 1;
+    f[0] = f[1] = f[2] = f[3] = 0.0;
+
+    if (reconstruction == Reconstruction::FirstOrder) {
+        splitFlux<double>(gamma, 1.0, Q(0, i - di, j - dj), Q(1, i - di, j - dj), Q(2, i - di, j - dj),
+                          Q(3, i - di, j - dj), nx, ny, len, f[0], f[1], f[2], f[3]);
+        splitFlux<double>(gamma, -1.0, Q(0, i, j), Q(1, i, j), Q(2, i, j), Q(3, i, j),
+                          nx, ny, len, f[0], f[1], f[2], f[3]);
+        return;
+    }
+
+    // rho, u, v, P of the four cells along the face normal, as primitiveRow
+    double w[4][4];
+    for (int c = 0; c < 4; ++c) {
+        const int ic = i + (c - 2) * di;
+        const int jc = j + (c - 2) * dj;
+        const double r = Q(0, ic, jc);
+        const double u = Q(1, ic, jc) / r;
+        const double v = Q(2, ic, jc) / r;
+        w[c][0] = r;
+        w[c][1] = u;
+        w[c][2] = v;
+        w[c][3] = (gamma - 1.0) * (Q(3, ic, jc) - 0.5 * r * (u * u + v * v));
+    }
+    switch (limiter) {
+    case Limiter::Minmod: faceFluxMUSCL<Limiter::Minmod>(gamma, w, jumpScale2, nx, ny, len, f); return;
+    case Limiter::VanLeer: faceFluxMUSCL<Limiter::VanLeer>(gamma, w, jumpScale2, nx, ny, len, f); return;
+    case Limiter::VanAlbada: faceFluxMUSCL<Limiter::VanAlbada>(gamma, w, jumpScale2, nx, ny, len, f); return;
+    }
+}
+
+const char *FluxSolver::simdTarget() {
+#if defined(__AVX512F__)
+    return "AVX-512";
+#elif defined(__AVX2__)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+
+void FluxSolver::computeResidual(const FlowState &Q, FlowState &R) {
+    computeResidual(Q, R, Tile{1, ni - 1, 1, nj - 1});
+}
+
+void FluxSolver::computeResidual(const FlowState &Q, FlowState &R, const Tile &region) {
+    sweepRegion(Q, R, region, xiFaces, etaFaces);
+}
+
+void FluxSolver::computeResidual(const FlowStateF &Q, FlowStateF &R) {
+    sweepRegion(Q, R, Tile{1, ni - 1, 1, nj - 1}, xiFacesF, etaFacesF);
+}
+
+void FluxSolver::computeResidual(const FlowState &Q, FlowState &R, const std::vector<unsigned char> &active) {
+    sweepRegion(Q, R, Tile{1, ni - 1, 1, nj - 1}, xiFaces, etaFaces, &active);
+}
+
+void FluxSolver::computeResidual(const FlowStateF &Q, FlowStateF &R, const std::vector<unsigned char> &active) {
+    sweepRegion(Q, R, Tile{1, ni - 1, 1, nj - 1}, xiFacesF, etaFacesF, &active);
+}
+
+template <typename Real>
+void FluxSolver::sweepRegion(const BasicFlowState<Real> &Q, BasicFlowState<Real> &R, const Tile &region,
+                             const BasicFaceMetrics<Real> &xi, const BasicFaceMetrics<Real> &eta,
+                             const std::vector<unsigned char> *active) {
+    ScopedTimer timer(Phase::Residual);
+    // the thread count may change between calls, so grow the scratch lazily
+    const std::size_t threads = static_cast<std::size_t>(getThreadCount());
+    if (scratch.size() < threads) {
+        scratch.resize(threads);
+    }
+    parallelFor(0, tiles.getTileCount(), [&](int t) {
+        if (active && !(*active)[t]) {
+            return;
+        }
+        const Tile &tile = tiles.getTile(t);
+        const Tile part{std::max(tile.iBegin, region.iBegin), std::min(tile.iEnd, region.iEnd),
+                        std::max(tile.jBegin, region.jBegin), std::min(tile.jEnd, region.jEnd)};
+        if (part.iBegin >= part.iEnd || part.jBegin >= part.jEnd) {
+            return;
+        }
+        Workspace &ws = scratch[getThreadIndex()];
+        reserveWorkspace(ws);
+        sweepTile(Q, R, part, ws, xi, eta);
+    });
+}
+
+void FluxSolver::reserveWorkspace(Workspace &ws) const {
+    // allocated by the thread that uses it
+    if (ws.xiFlux.empty()) {
+        ws.xiFlux.assign(4 * stride, 0.0);
+        ws.etaLo.assign(4 * stride, 0.0);
+        ws.etaHi.assign(4 * stride, 0.0);
+        ws.rowR.assign(8 * stride, 0.0);
+        ws.rowDt.assign(2 * stride, 0.0);
+    }
+    if (reconstruction == Reconstruction::MUSCL && ws.primitive.getNI() != ni) {
+        ws.primitive.resize(ni, 4);
+    }
+}
+
+// Storage may be float (Precision::Mixed); splitFlux<double> widens every
+// load, so the fluxes and their sums are always formed in double.
+template <typename Real>
+void FluxSolver::xiFluxRow(const BasicFlowState<Real> &Q, const BasicFaceMetrics<Real> &xi,
+                           int j, int iBegin, int iEnd, double *F, int i0, int j0) const {
+    const Real *rho = Q.row(0, j);
+    const Real *rhoU = Q.row(1, j);
+    const Real *rhoV = Q.row(2, j);
+    const Real *E = Q.row(3, j);
+    const Real *nx = xi.rowNX(j + j0) + i0;
+    const Real *ny = xi.rowNY(j + j0) + i0;
+    const Real *len = xi.rowLen(j + j0) + i0;
+    double *F0 = F;
+    double *F1 = F + stride;
+    double *F2 = F + 2 * stride;
+    double *F3 = F + 3 * stride;
+    const double g = gamma;
+
+    // face i: F+ from cell i-1, F- from cell i
+    EULER_PRAGMA_SIMD
+    for (int i = iBegin; i <= iEnd; ++i) {
+        double f0 = 0.0, f1 = 0.0, f2 = 0.0, f3 = 0.0;
+        splitFlux<double>(g, 1.0, rho[i - 1], rhoU[i - 1], rhoV[i - 1], E[i - 1],
+                          nx[i], ny[i], len[i], f0, f1, f2, f3);
+        splitFlux<double>(g, -1.0, rho[i], rhoU[i], rhoV[i], E[i],
+                          nx[i], ny[i], len[i], f0, f1, f2, f3);
+        F0[i] = f0;
+        F1[i] = f1;
+        F2[i] = f2;
+        F3[i] = f3;
+    }
+}
+
+template <typename Real>
+void FluxSolver::etaFluxRow(const BasicFlowState<Real> &Q, const BasicFaceMetrics<Real> &eta,
+                            int j, int iBegin, int iEnd, double *G, int i0, int j0) const {
+    const Real *rhoL = Q.row(0, j - 1), *rhoR = Q.row(0, j);
+    const Real *rhoUL = Q.row(1, j - 1), *rhoUR = Q.row(1, j);
+    const Real *rhoVL = Q.row(2, j - 1), *rhoVR = Q.row(2, j);
+    const Real *EL = Q.row(3, j - 1), *ER = Q.row(3, j);
+    const Real *nx = eta.rowNX(j + j0) + i0;
+    const Real *ny = eta.rowNY(j + j0) + i0;
+    const Real *len = eta.rowLen(j + j0) + i0;
+    double *G0 = G;
+    double *G1 = G + stride;
+    double *G2 = G + 2 * stride;
+    double *G3 = G + 3 * stride;
+    const double g = gamma;
+
+    // face j: G+ from cell j-1, G- from cell j
+    EULER_PRAGMA_SIMD
+    for (int i = iBegin; i < iEnd; ++i) {
+        double g0 = 0.0, g1 = 0.0, g2 = 0.0, g3 = 0.0;
+        splitFlux<double>(g, 1.0, rhoL[i], rhoUL[i], rhoVL[i], EL[i],
+                          nx[i], ny[i], len[i], g0, g1, g2, g3);
+        splitFlux<double>(g, -1.0, rhoR[i], rhoUR[i], rhoVR[i], ER[i],
+                          nx[i], ny[i], len[i], g0, g1, g2, g3);
+        G0[i] = g0;
+        G1[i] = g1;
+        G2[i] = g2;
+        G3[i] = g3;
+    }
+}
+
+template <typename Real>
+void FluxSolver::primitiveRow(const BasicFlowState<Real> &Q, int j, int iBegin, int iEnd, FlowState &W) const {
+    const Real *rhoQ = Q.row(0, j);
+    const Real *rhoUQ = Q.row(1, j);
+    const Real *rhoVQ = Q.row(2, j);
+    const Real *EQ = Q.row(3, j);
+    double *rho = W.row(0, j & 3);
+    double *u = W.row(1, j & 3);
+    double *v = W.row(2, j & 3);
+    double *P = W.row(3, j & 3);
+    const double g1 = gamma - 1.0;
+
+    EULER_PRAGMA_SIMD
+    for (int i = iBegin; i < iEnd; ++i) {
+        const double r = rhoQ[i];
+        const double uu = rhoUQ[i] / r;
+        const double vv = rhoVQ[i] / r;
+        rho[i] = r;
+        u[i] = uu;
+        v[i] = vv;
+        P[i] = g1 * (EQ[i] - 0.5 * r * (uu * uu + vv * vv));
+    }
+}
+
+template <Limiter L, typename Real>
+void FluxSolver::xiFluxRowMUSCL(const FlowState &W, const BasicFaceMetrics<Real> &xi,
+                                int j, int iBegin, int iEnd, double *F) const {
+    const double *rho = W.row(0, j & 3);
+    const double *u = W.row(1, j & 3);
+    const double *v = W.row(2, j & 3);
+    const double *P = W.row(3, j & 3);
+    const Real *nx = xi.rowNX(j);
+    const Real *ny = xi.rowNY(j);
+    const Real *len = xi.rowLen(j);
+    double *F0 = F;
+    double *F1 = F + stride;
+    double *F2 = F + 2 * stride;
+    double *F3 = F + 3 * stride;
+    const double g = gamma;
+    const double e0 = jumpScale2[0], e1 = jumpScale2[1], e2 = jumpScale2[2], e3 = jumpScale2[3];
+
+    // face i: F+ of the state extrapolated from cell i-1, F- of that from cell i
+    EULER_PRAGMA_SIMD
+    for (int i = iBegin; i <= iEnd; ++i) {
+        double rhoL, rhoR, uL, uR, vL, vR, PL, PR;
+        faceStates<L>(rho[i - 2], rho[i - 1], rho[i], rho[i + 1], e0, rhoL, rhoR);
+        faceStates<L>(u[i - 2], u[i - 1], u[i], u[i + 1], e1, uL, uR);
+        faceStates<L>(v[i - 2], v[i - 1], v[i], v[i + 1], e2, vL, vR);
+        faceStates<L>(P[i - 2], P[i - 1], P[i], P[i + 1], e3, PL, PR);
+        double f0 = 0.0, f1 = 0.0, f2 = 0.0, f3 = 0.0;
+        splitFluxPrimitive(g, 1.0, rhoL, uL, vL, PL, nx[i], ny[i], len[i], f0, f1, f2, f3);
+        splitFluxPrimitive(g, -1.0, rhoR, uR, vR, PR, nx[i], ny[i], len[i], f0, f1, f2, f3);
+        F0[i] = f0;
+        F1[i] = f1;
+        F2[i] = f2;
+        F3[i] = f3;
+    }
+}
+
+template <Limiter L, typename Real>
+void FluxSolver::etaFluxRowMUSCL(const FlowState &W, const BasicFaceMetrics<Real> &eta,
+                                 int j, int iBegin, int iEnd, double *G) const {
+    const double *rho[4], *u[4], *v[4], *P[4]; // rows j-2 .. j+1
+    for (int r = 0; r < 4; ++r) {
+        const int slot = (j - 2 + r) & 3;
+        rho[r] = W.row(0, slot);
+        u[r] = W.row(1, slot);
+        v[r] = W.row(2, slot);
+        P[r] = W.row(3, slot);
+    }
+    const Real *nx = eta.rowNX(j);
+    const Real *ny = eta.rowNY(j);
+    const Real *len = eta.rowLen(j);
+    double *G0 = G;
+    double *G1 = G + stride;
+    double *G2 = G + 2 * stride;
+    double *G3 = G + 3 * stride;
+    const double g = gamma;
+    const double e0 = jumpScale2[0], e1 = jumpScale2[1], e2 = jumpScale2[2], e3 = jumpScale2[3];
+
+    // face j: G+ of the state extrapolated from cell j-1, G- of that from cell j
+    EULER_PRAGMA_SIMD
+    for (int i = iBegin; i < iEnd; ++i) {
+        double rhoL, rhoR, uL, uR, vL, vR, PL, PR;
+        faceStates<L>(rho[0][i], rho[1][i], rho[2][i], rho[3][i], e0, rhoL, rhoR);
+        faceStates<L>(u[0][i], u[1][i], u[2][i], u[3][i], e1, uL, uR);
+        faceStates<L>(v[0][i], v[1][i], v[2][i], v[3][i], e2, vL, vR);
+        faceStates<L>(P[0][i], P[1][i], P[2][i], P[3][i], e3, PL, PR);
+        double g0 = 0.0, g1 = 0.0, g2 = 0.0, g3 = 0.0;
+        splitFluxPrimitive(g, 1.0, rhoL, uL, vL, PL, nx[i], ny[i], len[i], g0, g1, g2, g3);
+        splitFluxPrimitive(g, -1.0, rhoR, uR, vR, PR, nx[i], ny[i], len[i], g0, g1, g2, g3);
+        G0[i] = g0;
+        G1[i] = g1;
+        G2[i] = g2;
+        G3[i] = g3;
+    }
+}
+
+template <typename Real>
+void FluxSolver::sweepTile(const BasicFlowState<Real> &Q, BasicFlowState<Real> &R, const Tile &tile, Workspace &ws,
+                           const BasicFaceMetrics<Real> &xi, const BasicFaceMetrics<Real> &eta) const {
+    if (reconstruction == Reconstruction::MUSCL) {
+        switch (limiter) {
+        case Limiter::Minmod: sweepTileMUSCL<Limiter::Minmod>(Q, R, tile, ws, xi, eta); return;
+        case Limiter::VanLeer: sweepTileMUSCL<Limiter::VanLeer>(Q, R, tile, ws, xi, eta); return;
+        case Limiter::VanAlbada: sweepTileMUSCL<Limiter::VanAlbada>(Q, R, tile, ws, xi, eta); return;
+        }
+    }
+    const int iBegin = tile.iBegin;
+    const int iEnd = tile.iEnd;
+    differenceFluxes(R, tile, ws,
+                     [&](int j, double *F) { xiFluxRow(Q, xi, j, iBegin, iEnd, F); },
+                     [&](int j, double *G) { etaFluxRow(Q, eta, j, iBegin, iEnd, G); });
+}
+
+template <Limiter L, typename Real>
+void FluxSolver::sweepTileMUSCL(const BasicFlowState<Real> &Q, BasicFlowState<Real> &R, const Tile &tile,
+                                Workspace &ws, const BasicFaceMetrics<Real> &xi,
+                                const BasicFaceMetrics<Real> &eta) const {
+    const int iBegin = tile.iBegin;
+    const int iEnd = tile.iEnd;
+    FlowState &W = ws.primitive;
+
+    // rows jBegin-2 .. jEnd+1 pass through a ring of four primitive rows as
+    // the eta faces move up; the rows swept in xi need two more cells on
+    // either side, the others only the tile's columns
+    auto convert = [&](int j) {
+        const bool swept = j >= tile.jBegin && j < tile.jEnd;
+        primitiveRow(Q, j, swept ? iBegin - 2 : iBegin, swept ? iEnd + 2 : iEnd, W);
+    };
+    for (int j = tile.jBegin - 2; j <= tile.jBegin; ++j) {
+        convert(j);
+    }
+    differenceFluxes(R, tile, ws,
+                     [&](int j, double *F) { xiFluxRowMUSCL<L>(W, xi, j, iBegin, iEnd, F); },
+                     [&](int j, double *G) {
+                         convert(j + 1);
+                         etaFluxRowMUSCL<L>(W, eta, j, iBegin, iEnd, G);
+                     });
+}
+
+template <typename Real, typename XiRow, typename EtaRow>
+void FluxSolver::differenceFluxes(BasicFlowState<Real> &R, const Tile &tile, Workspace &ws,
+                                  XiRow &&xiRow, EtaRow &&etaRow) const {
+    double *F = ws.xiFlux.data();
+    double *Glo = ws.etaLo.data();
+    double *Ghi = ws.etaHi.data();
+    const int iBegin = tile.iBegin;
+    const int iEnd = tile.iEnd;
+
+    // profiler split of the sweep into flux construction and differencing
+    using Clock = std::chrono::steady_clock;
+    const bool timed = Profiler::enabled();
+    double construction = 0.0;
+    double differencing = 0.0;
+    Clock::time_point t0, t1;
+    if (timed) {
+        t0 = Clock::now();
+    }
+
+    // inside a tile every face is evaluated once: the eta fluxes above row j
+    // are reused as the ones below row j+1 (only the tile edges are redone)
+    etaRow(tile.jBegin, Glo);
+    for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+        xiRow(j, F);
+        etaRow(j + 1, Ghi);
+        if (timed) {
+            t1 = Clock::now();
+            construction += std::chrono::duration<double>(t1 - t0).count();
+        }
+
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            const double *Fk = F + k * stride;
+            const double *Gl = Glo + k * stride;
+            const double *Gh = Ghi + k * stride;
+            Real *Rk = R.row(k, j);
+            EULER_PRAGMA_SIMD
+            for (int i = iBegin; i < iEnd; ++i) {
+                Rk[i] = static_cast<Real>((Fk[i + 1] - Fk[i]) + (Gh[i] - Gl[i]));
+            }
+        }
+        std::swap(Glo, Ghi);
+        if (timed) {
+            t0 = Clock::now();
+            differencing += std::chrono::duration<double>(t0 - t1).count();
+        }
+    }
+    if (timed) {
+        Profiler::addFluxWork(construction, differencing);
+    }
+}
+
+template <typename Real>
+void FluxSolver::advance(const BasicFlowState<Real> &Q, BasicFlowState<Real> &Qnext,
+                         const AlignedVector<Real> &invVolume, const FusedStep &step,
+                         std::vector<ResidualNorms> &sums) {
+    ScopedTimer timer(Phase::Fused);
+    const std::size_t threads = static_cast<std::size_t>(getThreadCount());
+    if (scratch.size() < threads) {
+        scratch.resize(threads);
+    }
+    const int count = tiles.getTileCount();
+    const int steps = std::max(step.steps, 1);
+    sums.assign(static_cast<std::size_t>(steps) * count, ResidualNorms());
+
+    const BasicFaceMetrics<Real> *xi, *eta;
+    if constexpr (std::is_same_v<Real, float>) {
+        xi = &xiFacesF;
+        eta = &etaFacesF;
+    } else {
+        xi = &xiFaces;
+        eta = &etaFaces;
+    }
+
+    parallelFor(0, count, [&](int t) {
+        Workspace &ws = scratch[getThreadIndex()];
+        reserveWorkspace(ws);
+        advanceTile(Q, Qnext, invVolume, step, tiles.getTile(t), ws, sums.data() + t, count, *xi, *eta);
+    });
+}
+
+template <typename Real>
+void FluxSolver::advanceTile(const BasicFlowState<Real> &Q, BasicFlowState<Real> &Qnext,
+                             const AlignedVector<Real> &invVolume, const FusedStep &step,
+                             const Tile &tile, Workspace &ws, ResidualNorms *sums, int tileStride,
+                             const BasicFaceMetrics<Real> &xi, const BasicFaceMetrics<Real> &eta) const {
+    const int steps = std::max(step.steps, 1);
+    const Tile window{std::max(tile.iBegin - steps, 0), std::min(tile.iEnd + steps, ni),
+                      std::max(tile.jBegin - steps, 0), std::min(tile.jEnd + steps, nj)};
+    const int i0 = window.iBegin;
+    const int j0 = window.jBegin;
+    const int wi = window.iEnd - window.iBegin;
+    const int wj = window.jEnd - window.jBegin;
+
+    BasicFlowState<Real> *W;
+    if constexpr (std::is_same_v<Real, float>) {
+        W = &ws.windowF;
+    } else {
+        W = &ws.window;
+    }
+    if (W->getNI() < wi || W->getNJ() < wj) {
+        W->resize(std::max(W->getNI(), wi), std::max(W->getNJ(), wj));
+    }
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        for (int j = 0; j < wj; ++j) {
+            std::copy_n(Q.row(k, j0 + j) + i0, wi, W->row(k, j));
+        }
+    }
+
+    double *F = ws.xiFlux.data();
+    double *Glo = ws.etaLo.data();
+    double *Ghi = ws.etaHi.data();
+    const int wStride = stride;
+    const int ivStride = static_cast<int>(invVolume.size() / nj);
+    const double g = gamma;
+
+    for (int m = 0; m < steps; ++m) {
+        if (m > 0) {
+            step.boundary->applyBoundaryConditions(*W, window);
+        }
+        // cells updated in step m: the tile grown by the steps still to come
+        const int grow = steps - 1 - m;
+        const int iBegin = std::max(tile.iBegin - grow, 1) - i0;
+        const int iEnd = std::min(tile.iEnd + grow, ni - 1) - i0;
+        const int jBegin = std::max(tile.jBegin - grow, 1) - j0;
+        const int jEnd = std::min(tile.jEnd + grow, nj - 1) - j0;
+        ResidualNorms &norms = sums[static_cast<std::size_t>(m) * tileStride];
+
+        // Q -= dt / V * R for row r, once no flux needs its old values
+        auto updateRow = [&](int r) {
+            const double *Rr = ws.rowR.data() + (r & 1) * 4 * wStride;
+            const double *dt = ws.rowDt.data() + (r & 1) * wStride;
+            const Real *iv = invVolume.data() + static_cast<std::size_t>(r + j0) * ivStride + i0;
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                const double *Rk = Rr + k * wStride;
+                Real *Wk = W->row(k, r);
+                EULER_PRAGMA_SIMD
+                for (int i = iBegin; i < iEnd; ++i) {
+                    Wk[i] = static_cast<Real>(Wk[i] - dt[i] * iv[i] * Rk[i]);
+                }
+            }
+        };
+
+        etaFluxRow(*W, eta, jBegin, iBegin, iEnd, Glo, i0, j0);
+        for (int j = jBegin; j < jEnd; ++j) {
+            xiFluxRow(*W, xi, j, iBegin, iEnd, F, i0, j0);
+            etaFluxRow(*W, eta, j + 1, iBegin, iEnd, Ghi, i0, j0);
+
+            // residual of row j, rounded to the storage type as in the
+            // separate passes so both give the same state
+            double *Rj = ws.rowR.data() + (j & 1) * 4 * wStride;
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                const double *Fk = F + k * wStride;
+                const double *Gl = Glo + k * wStride;
+                const double *Gh = Ghi + k * wStride;
+                double *Rk = Rj + k * wStride;
+                EULER_PRAGMA_SIMD
+                for (int i = iBegin; i < iEnd; ++i) {
+                    Rk[i] = static_cast<Real>((Fk[i + 1] - Fk[i]) + (Gh[i] - Gl[i]));
+                }
+                if (step.forcing) {
+                    const double *Pk = step.forcing->row(k, j + j0) + i0;
+                    for (int i = iBegin; i < iEnd; ++i) {
+                        Rk[i] -= Pk[i];
+                    }
+                }
+            }
+
+            // local time step of row j from its state before the update
+            {
+                const Real *rho = W->row(0, j), *rhoU = W->row(1, j), *rhoV = W->row(2, j), *E = W->row(3, j);
+                const int gj = j + j0;
+                const Real *xnx = xi.rowNX(gj) + i0, *xny = xi.rowNY(gj) + i0, *xl = xi.rowLen(gj) + i0;
+                const Real *enx0 = eta.rowNX(gj) + i0, *eny0 = eta.rowNY(gj) + i0, *el0 = eta.rowLen(gj) + i0;
+                const Real *enx1 = eta.rowNX(gj + 1) + i0, *eny1 = eta.rowNY(gj + 1) + i0;
+                const Real *el1 = eta.rowLen(gj + 1) + i0;
+                const Real *iv = invVolume.data() + static_cast<std::size_t>(gj) * ivStride + i0;
+                double *dt = ws.rowDt.data() + (j & 1) * wStride;
+                for (int i = iBegin; i < iEnd; ++i) {
+                    const double sxX = 0.5 * (double(xnx[i]) * xl[i] + double(xnx[i + 1]) * xl[i + 1]);
+                    const double sxY = 0.5 * (double(xny[i]) * xl[i] + double(xny[i + 1]) * xl[i + 1]);
+                    const double seX = 0.5 * (double(enx0[i]) * el0[i] + double(enx1[i]) * el1[i]);
+                    const double seY = 0.5 * (double(eny0[i]) * el0[i] + double(eny1[i]) * el1[i]);
+                    const double lambda = spectralRadius(g, rho[i], rhoU[i], rhoV[i], E[i], sxX, sxY, seX, seY);
+                    dt[i] = static_cast<Real>(step.cfl / (iv[i] * lambda));
+                }
+            }
+
+            // residual sums over the tile's own cells
+            if (j + j0 >= tile.jBegin && j + j0 < tile.jEnd) {
+                for (int k = 0; k < FlowState::NVAR; ++k) {
+                    const double *Rk = Rj + k * wStride;
+                    double sum = 0.0;
+                    double peak = 0.0;
+                    for (int i = tile.iBegin - i0; i < tile.iEnd - i0; ++i) {
+                        sum += Rk[i] * Rk[i];
+                        peak = std::max(peak, std::fabs(Rk[i]));
+                    }
+                    norms.L2[k] += sum;
+                    norms.Linf[k] = std::max(norms.Linf[k], peak);
+                }
+            }
+
+            // row j-1 has been read by its last flux (eta face j)
+            if (j > jBegin) {
+                updateRow(j - 1);
+            }
+            std::swap(Glo, Ghi);
+        }
+        updateRow(jEnd - 1);
+    }
+
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+            std::copy_n(W->row(k, j - j0) + tile.iBegin - i0, tile.iEnd - tile.iBegin, Qnext.row(k, j) + tile.iBegin);
+        }
+    }
+}
+
+template void FluxSolver::advance(const FlowState &, FlowState &, const AlignedVector<double> &,
+                                  const FusedStep &, std::vector<ResidualNorms> &);
+template void FluxSolver::advance(const FlowStateF &, FlowStateF &, const AlignedVector<float> &,
+                                  const FusedStep &, std::vector<ResidualNorms> &);
@@ -0,0 +1,207 @@
+#include "GridGenerator.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr double pi = 3.14159265358979323846;
+
+// ramp of the reflection case: the fan from its end bends and weakens the
+// reflected shock, so the case is not the wedge mirrored
+constexpr double reflectionRamp = 1.0;
+
+struct GeometryName {
+    const char *name;
+    GridGeometry geometry;
+};
+constexpr GeometryName geometryNames[] = {
+    {"wedge", GridGeometry::Wedge},
+    {"expansion", GridGeometry::Expansion},
+    {"reflection", GridGeometry::Reflection},
+};
+
+bool geometryByName(const std::string &name, GridGeometry &geometry) {
+    for (const GeometryName &g : geometryNames) {
+        if (name == g.name) {
+            geometry = g.geometry;
+            return true;
+        }
+    }
+    return false;
+}
+
+// maps t in [0, 1] onto [0, 1] with the points crowded towards the clustered
+// ends by a tanh stretching of strength beta (beta = 0: uniform)
+double stretch(double t, double beta, bool atStart, bool atEnd) {
+    if (beta <= 0.0 || (!atStart && !atEnd)) {
+        return t;
+    }
+    if (atStart && atEnd) {
+        return 0.5 * (1.0 + std::tanh(beta * (2.0 * t - 1.0)) / std::tanh(beta));
+    }
+    if (atStart) {
+        return 1.0 + std::tanh(beta * (t - 1.0)) / std::tanh(beta);
+    }
+    return std::tanh(beta * t) / std::tanh(beta);
+}
+
+} // namespace
+
+bool generateGrid(const GridSpec &spec, GridHandler &grid) {
+    ScopedTimer timer(Phase::GridRead);
+    if (spec.ni < 3 || spec.nj < 3) {
+        std::cerr << "A generated grid needs at least 3 x 3 nodes.\n";
+        return false;
+    }
+    if (!(spec.length > 0.0) || !(spec.height > 0.0) || spec.corner < 0.0 || spec.corner >= spec.length ||
+        spec.rampLength < 0.0 || !(std::fabs(spec.angle) < 90.0)) {
+        std::cerr << "Invalid channel: length and height must be positive, the corner inside the channel "
+                     "and the angle below 90 degrees.\n";
+        return false;
+    }
+    const double rampEnd = spec.rampLength > 0.0 ? std::min(spec.corner + spec.rampLength, spec.length)
+                                                 : spec.length;
+
+    // segments between the inlet, the ramp ends and the outlet, each given
+    // nodes in proportion to its length so the ramp ends fall on nodes
+    std::vector<double> breaks = {0.0};
+    for (double b : {spec.corner, rampEnd, spec.length}) {
+        if (b > breaks.back()) {
+            breaks.push_back(b);
+        }
+    }
+    const int segments = static_cast<int>(breaks.size()) - 1;
+    const int intervals = spec.ni - 1;
+    if (intervals < segments) {
+        std::cerr << "Too few nodes along the channel for its " << segments << " segments.\n";
+        return false;
+    }
+    std::vector<int> at(breaks.size());
+    at[0] = 0;
+    at[segments] = intervals;
+    for (int s = 1; s < segments; ++s) {
+        const int n = static_cast<int>(std::lround(intervals * breaks[s] / spec.length));
+        at[s] = std::clamp(n, at[s - 1] + 1, intervals - (segments - s));
+    }
+
+    // column positions, clustered at the wall corners
+    auto isCorner = [&](double b) {
+        return (b == spec.corner && b > 0.0) || (b == rampEnd && b < spec.length);
+    };
+    std::vector<double> xs(spec.ni);
+    for (int s = 0; s < segments; ++s) {
+        const double width = breaks[s + 1] - breaks[s];
+        const bool atStart = isCorner(breaks[s]);
+        const bool atEnd = isCorner(breaks[s + 1]);
+        for (int n = at[s]; n < at[s + 1]; ++n) {
+            const double t = static_cast<double>(n - at[s]) / (at[s + 1] - at[s]);
+            xs[n] = breaks[s] + width * stretch(t, spec.stretchI, atStart, atEnd);
+        }
+        xs[at[s]] = breaks[s];
+    }
+    xs[intervals] = spec.length;
+
+    // walls: the ramp wall is straight up to the corner, turns by the angle
+    // and turns back at the end of the ramp
+    const bool upperRamp = spec.geometry == GridGeometry::Reflection;
+    const double slope = std::tan(spec.angle * pi / 180.0);
+    const double turn = spec.geometry == GridGeometry::Wedge ? slope : -slope;
+    std::vector<double> lower(spec.ni), upper(spec.ni);
+    for (int i = 0; i < spec.ni; ++i) {
+        const double ramp = turn * (std::clamp(xs[i], spec.corner, rampEnd) - spec.corner);
+        lower[i] = upperRamp ? 0.0 : ramp;
+        upper[i] = spec.height + (upperRamp ? ramp : 0.0);
+        if (upper[i] - lower[i] <= 0.0) {
+            std::cerr << "The ramp closes the channel at x = " << xs[i] << ".\n";
+            return false;
+        }
+    }
+
+    // rows spread from wall to wall, clustered at the ramp wall; columns
+    // (fixed j) are contiguous, so they are what the threads split
+    Eigen::MatrixXd x(spec.ni, spec.nj);
+    Eigen::MatrixXd y(spec.ni, spec.nj);
+    parallelFor(0, spec.nj, [&](int j) {
+        const double t = static_cast<double>(j) / (spec.nj - 1);
+        const double s = stretch(t, spec.stretchJ, !upperRamp, upperRamp);
+        for (int i = 0; i < spec.ni; ++i) {
+            x(i, j) = xs[i];
+            y(i, j) = lower[i] + s * (upper[i] - lower[i]);
+        }
+    });
+    grid.setNodes(std::move(x), std::move(y));
+    return true;
+}
+
+bool parseGridSpec(const std::string &text, GridSpec &spec) {
+    const std::size_t colon = text.find(':');
+    const std::string name = text.substr(0, colon);
+    GridSpec parsed;
+    if (!geometryByName(name, parsed.geometry)) {
+        std::cerr << "Unknown grid geometry '" << name << "' (wedge, expansion or reflection)\n";
+        return false;
+    }
+    if (parsed.geometry == GridGeometry::Reflection) {
+        parsed.rampLength = reflectionRamp;
+    }
+    if (colon == std::string::npos) {
+        spec = parsed;
+        return true;
+    }
+
+    struct Key {
+        const char *name;
+        double *real;
+        int *integer;
+    };
+    const Key keys[] = {
+        {"ni", nullptr, &parsed.ni},
+        {"nj", nullptr, &parsed.nj},
+        {"length", &parsed.length, nullptr},
+        {"height", &parsed.height, nullptr},
+        {"corner", &parsed.corner, nullptr},
+        {"angle", &parsed.angle, nullptr},
+        {"ramp", &parsed.rampLength, nullptr},
+        {"stretchi", &parsed.stretchI, nullptr},
+        {"stretchj", &parsed.stretchJ, nullptr},
+    };
+
+    std::istringstream fields(text.substr(colon + 1));
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        const std::size_t eq = field.find('=');
+        const std::string key = field.substr(0, eq);
+        const Key *match = nullptr;
+        for (const Key &k : keys) {
+            if (key == k.name) {
+                match = &k;
+            }
+        }
+        std::istringstream number(eq == std::string::npos ? "" : field.substr(eq + 1));
+        double value = 0.0;
+        const bool ok = match && (number >> value) && (number >> std::ws).eof() &&
+                        (match->real || (value == std::floor(value) && std::fabs(value) < 1e9));
+        if (!ok) {
+            std::cerr << "Bad grid parameter '" << field << "' in " << text << "\n";
+            return false;
+        }
+        if (match->real) {
+            *match->real = value;
+        } else {
+            *match->integer = static_cast<int>(value);
+        }
+    }
+    spec = parsed;
+    return true;
+}
+
+bool isGridSpec(const std::string &text) {
+    GridGeometry geometry;
+    return geometryByName(text.substr(0, text.find(':')), geometry);
+}
@@ -1,25 +1,84 @@
 #include "GridHandler.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Profiler.h"
 #include <matplot/matplot.h>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <limits>
+#include <utility>
 
 using namespace matplot;
 
 GridHandler::GridHandler() : nx(0), ny(0) { }
 
+namespace {
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// one "x, y" record starting at p (leading blanks allowed); advances p past
+// the end of the line
+bool parseRecord(const char *&p, const char *end, double &xVal, double &yVal) {
+    auto number = [&](double &value) {
+        while (p < end && isBlank(*p)) ++p;
+        if (p < end && *p == '+') ++p; // from_chars rejects an explicit '+'
+        const std::from_chars_result r = std::from_chars(p, end, value);
+        if (r.ec != std::errc()) {
+            return false;
+        }
+        p = r.ptr;
+        return true;
+    };
+    if (!number(xVal)) {
+        return false;
+    }
+    while (p < end && isBlank(*p)) ++p;
+    if (p >= end || *p != ',') {
+        return false;
+    }
+    ++p;
+    if (!number(yVal)) {
+        return false;
+    }
+    while (p < end && *p != '\n') ++p;
+    if (p < end) ++p;
+    return true;
+}
+
+// true if the line starting at p holds anything but blanks
+bool hasRecord(const char *p, const char *end) {
+    for (; p < end && *p != '\n'; ++p) {
+        if (!isBlank(*p)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 bool GridHandler::readGridFile(const std::string &filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filename << "\n";
+    ScopedTimer timer(Phase::GridRead);
+    MappedFile file;
+    if (!file.open(filename)) {
         return false;
     }
+    const char *begin = file.data();
+    const char *fileEnd = begin + file.size();
 
     // Read header line (e.g., "ZONE i=641, j=65").
-    std::string header;
-    std::getline(file, header);
+    const char *eol = std::find(begin, fileEnd, '\n');
+    const std::string header(begin, eol);
+    const char *body = eol < fileEnd ? eol + 1 : fileEnd;
 
     // Parse grid dimensions from the header.
     size_t pos = header.find("i=");
@@ -42,30 +101,274 @@ bool GridHandler::readGridFile(const std::string &filename) {
         return false;
     }
 
-    // Reserve space in vectors.
-    std::vector<double> xvals;
-    std::vector<double> yvals;
-    xvals.reserve(nx * ny);
-    yvals.reserve(nx * ny);
+    // Split the body into one chunk per thread at line boundaries (a single
+    // chunk for small files), count the records of every chunk, then parse
+    // each chunk straight into its slice of x and y.
+    const std::size_t bytes = static_cast<std::size_t>(fileEnd - body);
+    const int chunks = bytes < (std::size_t(1) << 20) ? 1 : getThreadCount();
+    std::vector<const char *> cut(chunks + 1, fileEnd);
+    cut[0] = body;
+    for (int c = 1; c < chunks; ++c) {
+        const char *p = body + bytes * c / chunks;
+        p = std::max(p, cut[c - 1]);
+        p = std::find(p, fileEnd, '\n');
+        cut[c] = p < fileEnd ? p + 1 : fileEnd;
+    }
 
-    double xVal, yVal;
-    char comma;
-    while (file >> xVal >> comma >> yVal) {
-        xvals.push_back(xVal);
-        yvals.push_back(yVal);
+    std::vector<long> records(chunks + 1, 0);
+    parallelFor(0, chunks, [&](int c) {
+        long n = 0;
+        for (const char *p = cut[c]; p < cut[c + 1];) {
+            n += hasRecord(p, cut[c + 1]) ? 1 : 0;
+            p = std::find(p, cut[c + 1], '\n');
+            if (p < cut[c + 1]) ++p;
+        }
+        records[c + 1] = n;
+    });
+    for (int c = 0; c < chunks; ++c) {
+        records[c + 1] += records[c];
     }
 
-    if (static_cast<int>(xvals.size()) != nx * ny) {
-        std::cerr << "Data size (" << xvals.size() 
-                  << ") does not match expected grid dimensions (" 
+    if (records[chunks] != static_cast<long>(nx) * ny) {
+        std::cerr << "Data size (" << records[chunks]
+                  << ") does not match expected grid dimensions ("
                   << nx << " * " << ny << ").\n";
         return false;
     }
 
-    // Map the data into Eigen matrices (data stored in column-major order).
-    x = Eigen::Map<const Eigen::MatrixXd>(xvals.data(), nx, ny);
-    y = Eigen::Map<const Eigen::MatrixXd>(yvals.data(), nx, ny);
+    // Data is stored in column-major order, exactly Eigen's layout.
+    x.resize(nx, ny);
+    y.resize(nx, ny);
+    std::vector<long> badRecord(chunks, -1);
+    parallelFor(0, chunks, [&](int c) {
+        double *xOut = x.data() + records[c];
+        double *yOut = y.data() + records[c];
+        long n = 0;
+        for (const char *p = cut[c]; p < cut[c + 1];) {
+            if (!hasRecord(p, cut[c + 1])) {
+                p = std::find(p, cut[c + 1], '\n');
+                if (p < cut[c + 1]) ++p;
+                continue;
+            }
+            if (!parseRecord(p, cut[c + 1], xOut[n], yOut[n])) {
+                badRecord[c] = records[c] + n;
+                return;
+            }
+            ++n;
+        }
+    });
+    for (int c = 0; c < chunks; ++c) {
+        if (badRecord[c] >= 0) {
+            std::cerr << "Malformed grid point " << badRecord[c] << " in " << filename << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool GridHandler::writeGridFile(const std::string &filename) const {
+    // computed metrics mean the nodes carry the halo layer
+    const int h = cellVolume.size() > 0 ? 1 : 0;
+    const int nodesI = nx - 2 * h;
+    const int nodesJ = ny - 2 * h;
+
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    file << " ZONE i=" << nodesI << ", j=" << nodesJ << "\n";
+
+    // shortest round-trip text, a column at a time
+    std::string column;
+    char number[32];
+    auto put = [&](double value) {
+        const std::to_chars_result r = std::to_chars(number, number + sizeof(number), value);
+        column.append(number, r.ptr);
+    };
+    for (int j = h; j < h + nodesJ; ++j) {
+        column.clear();
+        for (int i = h; i < h + nodesI; ++i) {
+            put(x(i, j));
+            column += ", ";
+            put(y(i, j));
+            column += '\n';
+        }
+        file << column;
+    }
+
+    if (!file) {
+        std::cerr << "Failed to write grid file: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+void GridHandler::setNodes(Eigen::MatrixXd xNodes, Eigen::MatrixXd yNodes) {
+    x = std::move(xNodes);
+    y = std::move(yNodes);
+    nx = static_cast<int>(x.rows());
+    ny = static_cast<int>(x.cols());
+
+    // metrics of a previous grid no longer apply
+    xCenter.resize(0, 0);
+    yCenter.resize(0, 0);
+    cellVolume.resize(0, 0);
+    xArea_Xi.resize(0, 0);
+    yArea_Xi.resize(0, 0);
+    xArea_Eta.resize(0, 0);
+    yArea_Eta.resize(0, 0);
+}
+
+namespace {
+
+// binary cache layout: CacheHeader, then every matrix as int32 rows, int32
+// cols and rows * cols doubles (column-major), in the order of cacheFields
+struct CacheHeader {
+    char magic[8];            // "EULGRID"
+    std::uint32_t version;    // bumped when the layout changes
+    std::uint32_t byteOrder;  // 0x01020304 as written by the producer
+    std::int32_t nx, ny;      // node counts of the stored grid
+    std::int32_t hasMetrics;  // 1 if halo-extended metrics follow the nodes
+    std::int32_t reserved;
+    std::uint64_t sourceSize; // size of the text grid it came from (0 = unknown)
+    std::int64_t sourceTime;  // its modification time
+};
+
+constexpr char cacheMagic[8] = "EULGRID";
+constexpr std::uint32_t cacheVersion = 1;
+constexpr std::uint32_t cacheByteOrder = 0x01020304;
 
+// size and modification time identifying the state of a source file
+bool sourceStamp(const std::string &source, std::uint64_t &size, std::int64_t &time) {
+    std::error_code ec;
+    size = std::filesystem::file_size(source, ec);
+    if (ec) {
+        return false;
+    }
+    const auto stamp = std::filesystem::last_write_time(source, ec);
+    if (ec) {
+        return false;
+    }
+    time = static_cast<std::int64_t>(stamp.time_since_epoch().count());
+    return true;
+}
+
+} // namespace
+
+bool GridHandler::writeCache(const std::string &filename, const std::string &source) const {
+    CacheHeader header{};
+    std::copy(cacheMagic, cacheMagic + 8, header.magic);
+    header.version = cacheVersion;
+    header.byteOrder = cacheByteOrder;
+    header.nx = nx;
+    header.ny = ny;
+    header.hasMetrics = cellVolume.size() > 0 ? 1 : 0;
+    if (!source.empty() && !sourceStamp(source, header.sourceSize, header.sourceTime)) {
+        std::cerr << "Unable to stat grid source: " << source << "\n";
+        return false;
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    auto put = [&](const Eigen::MatrixXd &m) {
+        const std::int32_t dims[2] = {static_cast<std::int32_t>(m.rows()), static_cast<std::int32_t>(m.cols())};
+        file.write(reinterpret_cast<const char *>(dims), sizeof(dims));
+        file.write(reinterpret_cast<const char *>(m.data()), static_cast<std::streamsize>(m.size() * sizeof(double)));
+    };
+    put(x);
+    put(y);
+    if (header.hasMetrics) {
+        for (const Eigen::MatrixXd *m : {&xCenter, &yCenter, &cellVolume, &xArea_Xi, &yArea_Xi, &xArea_Eta, &yArea_Eta}) {
+            put(*m);
+        }
+    }
+
+    if (!file) {
+        std::cerr << "Failed to write grid cache: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool GridHandler::readCache(const std::string &filename, const std::string &source) {
+    ScopedTimer timer(Phase::GridRead);
+    MappedFile file;
+    if (!file.open(filename)) {
+        return false;
+    }
+    const char *p = file.data();
+    const char *fileEnd = p + file.size();
+
+    CacheHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << "Grid cache too short: " << filename << "\n";
+        return false;
+    }
+    std::memcpy(&header, p, sizeof(header));
+    p += sizeof(header);
+    if (!std::equal(cacheMagic, cacheMagic + 8, header.magic) || header.version != cacheVersion ||
+        header.byteOrder != cacheByteOrder) {
+        std::cerr << "Not a compatible grid cache: " << filename << "\n";
+        return false;
+    }
+    if (!source.empty()) {
+        std::uint64_t size = 0;
+        std::int64_t time = 0;
+        if (!sourceStamp(source, size, time) || size != header.sourceSize || time != header.sourceTime) {
+            std::cerr << "Grid cache " << filename << " is out of date with " << source << "\n";
+            return false;
+        }
+    }
+
+    auto get = [&](Eigen::MatrixXd &m) {
+        std::int32_t dims[2];
+        if (fileEnd - p < static_cast<std::ptrdiff_t>(sizeof(dims))) {
+            return false;
+        }
+        std::memcpy(dims, p, sizeof(dims));
+        p += sizeof(dims);
+        const std::size_t bytes = static_cast<std::size_t>(dims[0]) * dims[1] * sizeof(double);
+        if (dims[0] < 0 || dims[1] < 0 || static_cast<std::size_t>(fileEnd - p) < bytes) {
+            return false;
+        }
+        m.resize(dims[0], dims[1]);
+        std::memcpy(m.data(), p, bytes);
+        p += bytes;
+        return true;
+    };
+    bool ok = get(x) && get(y);
+    if (ok && header.hasMetrics) {
+        for (Eigen::MatrixXd *m : {&xCenter, &yCenter, &cellVolume, &xArea_Xi, &yArea_Xi, &xArea_Eta, &yArea_Eta}) {
+            ok = ok && get(*m);
+        }
+    }
+    if (!ok || x.rows() != header.nx || x.cols() != header.ny) {
+        std::cerr << "Truncated or inconsistent grid cache: " << filename << "\n";
+        return false;
+    }
+    nx = header.nx;
+    ny = header.ny;
+    return true;
+}
+
+bool GridHandler::loadGrid(const std::string &gridFile, const std::string &cacheFile) {
+    std::error_code ec;
+    if (std::filesystem::exists(cacheFile, ec) && readCache(cacheFile, gridFile) && cellVolume.size() > 0) {
+        return true;
+    }
+    if (!readGridFile(gridFile)) {
+        return false;
+    }
+    computeCellMetrics();
+    // a cache that cannot be written only costs the next run its head start
+    writeCache(cacheFile, gridFile);
     return true;
 }
 
@@ -109,9 +412,125 @@ void GridHandler::haloCell() {
 }
 
 void GridHandler::computeCellMetrics() {
+    ScopedTimer timer(Phase::CellMetrics);
     // Extend the grid by adding ghost cells.
     haloCell();
+    computeMetricsFromNodes();
+}
 
+bool GridHandler::agglomerate(const GridHandler &fine) {
+    // fine interior cells must pair up in both directions
+    const int fineCellsI = fine.nx - 3;
+    const int fineCellsJ = fine.ny - 3;
+    if (fineCellsI < 2 || fineCellsJ < 2 || fineCellsI % 2 != 0 || fineCellsJ % 2 != 0) {
+        std::cerr << "Cannot agglomerate a grid with " << fineCellsI << " x " << fineCellsJ
+                  << " interior cells.\n";
+        return false;
+    }
+
+    // every other node of the original (non-halo) fine grid
+    nx = fineCellsI / 2 + 1;
+    ny = fineCellsJ / 2 + 1;
+    x.resize(nx, ny);
+    y.resize(nx, ny);
+    parallelFor(0, ny, [&](int j) {
+        for (int i = 0; i < nx; ++i) {
+            x(i, j) = fine.x(1 + 2 * i, 1 + 2 * j);
+            y(i, j) = fine.y(1 + 2 * i, 1 + 2 * j);
+        }
+    });
+
+    // halo geometry and centers come from the coarse nodes as usual
+    haloCell();
+    computeMetricsFromNodes();
+
+    // interior volumes and face areas are the exact sums of the 2x2 fine
+    // children, so the coarse cells are conservative agglomerates
+    parallelFor(1, ny - 2, [&](int j) {
+        for (int i = 1; i < nx - 2; ++i) {
+            cellVolume(i, j) = fine.cellVolume(2 * i - 1, 2 * j - 1) + fine.cellVolume(2 * i, 2 * j - 1) +
+                               fine.cellVolume(2 * i - 1, 2 * j) + fine.cellVolume(2 * i, 2 * j);
+        }
+    });
+    parallelFor(1, ny - 2, [&](int j) {
+        for (int i = 1; i < nx - 1; ++i) {
+            xArea_Xi(i - 1, j - 1) = fine.xArea_Xi(2 * i - 2, 2 * j - 2) + fine.xArea_Xi(2 * i - 2, 2 * j - 1);
+            yArea_Xi(i - 1, j - 1) = fine.yArea_Xi(2 * i - 2, 2 * j - 2) + fine.yArea_Xi(2 * i - 2, 2 * j - 1);
+        }
+    });
+    parallelFor(1, ny - 1, [&](int j) {
+        for (int i = 1; i < nx - 2; ++i) {
+            xArea_Eta(i - 1, j - 1) = fine.xArea_Eta(2 * i - 2, 2 * j - 2) + fine.xArea_Eta(2 * i - 1, 2 * j - 2);
+            yArea_Eta(i - 1, j - 1) = fine.yArea_Eta(2 * i - 2, 2 * j - 2) + fine.yArea_Eta(2 * i - 1, 2 * j - 2);
+        }
+    });
+    return true;
+}
+
+bool GridHandler::extractBlock(const GridHandler &global, int iBegin, int iEnd, int jBegin, int jEnd) {
+    if (iBegin < 1 || jBegin < 1 || iEnd > global.nx - 2 || jEnd > global.ny - 2 ||
+        iBegin >= iEnd || jBegin >= jEnd) {
+        std::cerr << "Block [" << iBegin << ", " << iEnd << ") x [" << jBegin << ", " << jEnd
+                  << ") is outside the " << global.nx - 1 << " x " << global.ny - 1 << " cell grid.\n";
+        return false;
+    }
+
+    // cells iBegin-1 .. iEnd (ghosts included) span nodes iBegin-1 .. iEnd+1
+    const int blockNX = iEnd - iBegin + 3;
+    const int blockNY = jEnd - jBegin + 3;
+    setBlockNodes(global.x.block(iBegin - 1, jBegin - 1, blockNX, blockNY),
+                  global.y.block(iBegin - 1, jBegin - 1, blockNX, blockNY));
+    return true;
+}
+
+void GridHandler::setBlockNodes(Eigen::MatrixXd xNodes, Eigen::MatrixXd yNodes) {
+    x = std::move(xNodes);
+    y = std::move(yNodes);
+    nx = static_cast<int>(x.rows());
+    ny = static_cast<int>(x.cols());
+    computeMetricsFromNodes();
+}
+
+bool GridHandler::refineBlock(const GridHandler &parent, int iBegin, int iEnd, int jBegin, int jEnd, int ratio) {
+    if (ratio < 2 || iBegin < 1 || jBegin < 1 || iEnd > parent.nx - 2 || jEnd > parent.ny - 2 ||
+        iBegin >= iEnd || jBegin >= jEnd) {
+        std::cerr << "Cannot refine block [" << iBegin << ", " << iEnd << ") x [" << jBegin << ", " << jEnd
+                  << ") of the " << parent.nx - 1 << " x " << parent.ny - 1 << " cell grid by " << ratio << ".\n";
+        return false;
+    }
+
+    // fine node p lies at parent node line iBegin + (p - 1) / ratio, so the
+    // ghost nodes sit one fine cell into the neighbouring parent cells
+    nx = (iEnd - iBegin) * ratio + 3;
+    ny = (jEnd - jBegin) * ratio + 3;
+    x.resize(nx, ny);
+    y.resize(nx, ny);
+    auto locate = [ratio](int begin, int p, int &cell, double &t) {
+        const int q = p - 1 + ratio; // shifted so the division rounds down
+        cell = begin - 1 + q / ratio;
+        t = static_cast<double>(q % ratio) / ratio;
+    };
+    parallelFor(0, ny, [&](int q) {
+        int J;
+        double t;
+        locate(jBegin, q, J, t);
+        for (int p = 0; p < nx; ++p) {
+            int I;
+            double s;
+            locate(iBegin, p, I, s);
+            auto blend = [&](const Eigen::MatrixXd &c) {
+                return (1.0 - s) * (1.0 - t) * c(I, J) + s * (1.0 - t) * c(I + 1, J) +
+                       (1.0 - s) * t * c(I, J + 1) + s * t * c(I + 1, J + 1);
+            };
+            x(p, q) = blend(parent.x);
+            y(p, q) = blend(parent.y);
+        }
+    });
+    computeMetricsFromNodes();
+    return true;
+}
+
+void GridHandler::computeMetricsFromNodes() {
     // Compute cell-centered coordinates for the grid
     xCenter = x.block(0, 0, nx - 1, ny - 1) +
               0.5 * (x.block(1, 1, nx - 1, ny - 1) - x.block(0, 0, nx - 1, ny - 1));
@@ -121,34 +540,38 @@ void GridHandler::computeCellMetrics() {
     // Compute cell volumes using the determinant method
     cellVolume = Eigen::MatrixXd::Zero(nx - 1, ny - 1);
 
-    for (int i = 0; i < nx - 1; ++i) {
-        for (int j = 0; j < ny - 1; ++j) {
+    // columns (fixed j) are contiguous, so they are what the threads split
+    parallelFor(0, ny - 1, [&](int j) {
+        for (int i = 0; i < nx - 1; ++i) {
             cellVolume(i, j) = 0.5 * ((x(i + 1, j + 1) - x(i, j)) * (y(i, j + 1) - y(i + 1, j)) -
                                       (y(i + 1, j + 1) - y(i, j)) * (x(i, j + 1) - x(i + 1, j)));
         }
-    }
+    });
 
-    // Compute face areas in the ξ (xi) direction
+    // Compute face areas in the ξ (xi) direction. Face (i, j) is the node line i
+    // between nodes j and j+1, i.e. the face shared by cells i-1 and i; the
+    // components are those of the area vector pointing towards +xi.
     xArea_Xi = Eigen::MatrixXd::Zero(nx - 2, ny - 3);
     yArea_Xi = Eigen::MatrixXd::Zero(nx - 2, ny - 3);
 
-    for (int i = 1; i < nx - 1; ++i) {
-        for (int j = 1; j < ny - 2; ++j) {
-            xArea_Xi(i - 1, j - 1) = y(i + 1, j + 1) - y(i + 1, j);
-            yArea_Xi(i - 1, j - 1) = x(i + 1, j + 1) - x(i + 1, j);
+    parallelFor(1, ny - 2, [&](int j) {
+        for (int i = 1; i < nx - 1; ++i) {
+            xArea_Xi(i - 1, j - 1) = y(i, j + 1) - y(i, j);
+            yArea_Xi(i - 1, j - 1) = -(x(i, j + 1) - x(i, j));
         }
-    }
+    });
 
-    // Compute face areas in the η (eta) direction
-    xArea_Eta = Eigen::MatrixXd::Zero(nx - 3, ny - 1);
-    yArea_Eta = Eigen::MatrixXd::Zero(nx - 3, ny - 1);
+    // Compute face areas in the η (eta) direction. Face (i, j) is the node line j
+    // between nodes i and i+1, shared by cells j-1 and j, pointing towards +eta.
+    xArea_Eta = Eigen::MatrixXd::Zero(nx - 3, ny - 2);
+    yArea_Eta = Eigen::MatrixXd::Zero(nx - 3, ny - 2);
 
-    for (int i = 1; i < nx - 2; ++i) {
-        for (int j = 1; j < ny - 1; ++j) {
-            xArea_Eta(i - 1, j - 1) = y(i + 1, j + 1) - y(i, j + 1);
-            yArea_Eta(i - 1, j - 1) = x(i + 1, j + 1) - x(i, j + 1);
+    parallelFor(1, ny - 1, [&](int j) {
+        for (int i = 1; i < nx - 2; ++i) {
+            xArea_Eta(i - 1, j - 1) = -(y(i + 1, j) - y(i, j));
+            yArea_Eta(i - 1, j - 1) = x(i + 1, j) - x(i, j);
         }
-    }
+    });
 }
 
 
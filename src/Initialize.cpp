@@ -1,33 +1,57 @@
 #include "Initialize.h"
+#include "Parallel.h"
+#include "Profiler.h"
 #include <Eigen/Dense>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
-Initialize::Initialize(GridHandler &grid_,
+Initialize::Initialize(const GridHandler &grid_,
                        double R_,
                        double gamma_,
                        double Cp_)
-  : grid(grid_), R(R_), gamma(gamma_), Cp(Cp_)
+  : grid(grid_), R(R_), gamma(gamma_), Cp(Cp_),
+    Q{StateMap(nullptr, 0, 0, Eigen::OuterStride<>(0)),
+      StateMap(nullptr, 0, 0, Eigen::OuterStride<>(0)),
+      StateMap(nullptr, 0, 0, Eigen::OuterStride<>(0)),
+      StateMap(nullptr, 0, 0, Eigen::OuterStride<>(0))}
 {
+    allocate();
+}
+
+void Initialize::allocate() {
     // after grid.computeCellMetrics(), grid has been halo‑extended,
-    const int &ni = grid.getNX();
-    const int &nj = grid.getNY();
+    // one state entry per cell (halo layer included)
+    state.resize(grid.getCellNX(), grid.getCellNY());
+    bindViews();
+}
 
-    for (auto &mat : Q) {
-        mat.setZero(ni, nj);
+void Initialize::bindViews() {
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        // Eigen::Map cannot be reseated, so rebuild it in place
+        new (&Q[k]) StateMap(state.plane(k), state.getNI(), state.getNJ(), Eigen::OuterStride<>(state.getStride()));
     }
 }
 
+void Initialize::swapState(FlowState &other) {
+    state.swap(other);
+    bindViews();
+}
+
 void Initialize::packToQ(const Eigen::MatrixXd &P,
     const Eigen::MatrixXd &u,
     const Eigen::MatrixXd &v,
     const Eigen::MatrixXd &T) {
-Eigen::MatrixXd rho = (P.array() / T.array()) / R;
-Q[RHO]   = rho;
-Q[RHO_U]  = rho.array() * u.array();
-Q[RHO_V]  = rho.array() * v.array();
-Q[ENERGY]= (P.array() / (gamma-1.0)) +
-0.5 * rho.array() * (u.array().square() + v.array().square());
+    // one pass per column, no temporary density field
+    parallelFor(0, static_cast<int>(P.cols()), [&](int j) {
+        for (int i = 0; i < P.rows(); ++i) {
+            const double rho = P(i, j) / (R * T(i, j));
+            Q[RHO](i, j) = rho;
+            Q[RHO_U](i, j) = rho * u(i, j);
+            Q[RHO_V](i, j) = rho * v(i, j);
+            Q[ENERGY](i, j) = P(i, j) / (gamma - 1.0) + 0.5 * rho * (u(i, j) * u(i, j) + v(i, j) * v(i, j));
+        }
+    });
 }
 
 
@@ -39,94 +63,157 @@ void Initialize::setInitialConditions(double P0, double T0, double M0) {
     double rho0 = P0 / (R * T0);
     double e0 = P0 / (gamma - 1.0) + 0.5 * rho0 * (u0*u0 + v0*v0);
 
-    int ni = grid.getNX();
-    int nj = grid.getNY();
-
-    // Allocate full-size fields, initialize to zero
-    Eigen::MatrixXd P = Eigen::MatrixXd::Zero(ni, nj);
-    Eigen::MatrixXd u = Eigen::MatrixXd::Zero(ni, nj);
-    Eigen::MatrixXd v = Eigen::MatrixXd::Zero(ni, nj);
-    Eigen::MatrixXd T = Eigen::MatrixXd::Zero(ni, nj);
+    int ni = grid.getCellNX();
+    int nj = grid.getCellNY();
+    if (state.getNI() != ni || state.getNJ() != nj) {
+        allocate();
+    }
 
-    // Fill only interior cells
-    P.block(1, 1, ni-2, nj-2).setConstant(P0);
-    u.block(1, 1, ni-2, nj-2).setConstant(u0);
-    v.block(1, 1, ni-2, nj-2).setConstant(v0);
-    T.block(1, 1, ni-2, nj-2).setConstant(T0);
+    // keep the freestream state for the inlet halos
+    Qinf = {rho0, rho0 * u0, rho0 * v0, e0};
 
-    // populate state vector
-    packToQ(P, u, v, T);
+    // freestream in the interior cells, zero in the halos until the BCs
+    state.setZero();
+    parallelFor(1, nj - 1, [&](int j) {
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            std::fill(state.row(k, j) + 1, state.row(k, j) + ni - 1, Qinf[k]);
+        }
+    });
 }
 
 void Initialize::applyBoundaryConditions() {
-    setInletConditions();
-    setOutletConditions();
-    setWallConditions();
+    applyBoundaryConditions(state);
 }
 
-void Initialize::setInletConditions() {
-    // supersonic inflow: prescribe all freestream -> copy into i=0 ghosts
-    int nj = grid.getNY();
+template <typename Real>
+void Initialize::applyBoundaryConditions(BasicFlowState<Real> &Q) const {
+    ScopedTimer timer(Phase::Boundary);
+    imposeBoundaryConditions(Q, Tile{0, grid.getCellNX(), 0, grid.getCellNY()}, true);
+}
 
-    for (int j = 0; j < nj; ++j) {
-        Q[RHO](0,j) = Q[RHO](1,j); 
-        Q[RHO_U](0,j) = Q[RHO_U](1,j);
-        Q[RHO_V](0,j) = Q[RHO_V](1,j);
-        Q[ENERGY](0,j) = Q[ENERGY](1,j);
-    }
+template <typename Real>
+void Initialize::applyBoundaryConditions(BasicFlowState<Real> &W, const Tile &window) const {
+    imposeBoundaryConditions(W, window, false);
 }
 
-void Initialize::setOutletConditions() {
-    // supersonic outflow: zero‐gradient -> copy last interior into ghost
-    int ni = grid.getNX();
-    int nj = grid.getNY();
-    for (int j = 0; j < nj; ++j) {
-        Q[RHO](ni-1,j) = Q[RHO](ni-2,j);
-        Q[RHO_U](ni-1,j) = Q[RHO_U](ni-2,j);
-        Q[RHO_V](ni-1,j) = Q[RHO_V](ni-2,j);
-        Q[ENERGY](ni-1,j) = Q[ENERGY](ni-2,j);
+namespace {
+
+// body(n) for n in [begin, end), over the threads for the whole grid
+template <typename Body>
+void boundaryLoop(bool parallel, int begin, int end, Body &&body) {
+    if (parallel) {
+        parallelFor(begin, end, body);
+        return;
+    }
+    for (int n = begin; n < end; ++n) {
+        body(n);
     }
 }
 
-void Initialize::setWallConditions() {
-    // inviscid slip wall on top/bottom: reflect normal momentum
-    int ni = grid.getNX();
-    int nj = grid.getNY();
-
-    // bottom (j=0) and top (j=jmax-1)
-    for (int i = 0; i < ni; ++i) {
-        // bottom wall: j=0 -> j=1, flip normal velocity (rhoV)
-        Q[RHO](i,0) = Q[RHO](i,1);
-        Q[RHO_U](i,0) = Q[RHO_U](i,1);
-        Q[RHO_V](i,0) = -Q[RHO_V](i,1);
-        Q[ENERGY](i,0) = Q[ENERGY](i,1);
-
-        // top wall
-        Q[RHO](i,nj-1) = Q[RHO](i,nj-2);
-        Q[RHO_U](i,nj-1) = Q[RHO_U](i,nj-2);
-        Q[RHO_V](i,nj-1) = -Q[RHO_V](i,nj-2);
-        Q[ENERGY](i,nj-1) = Q[ENERGY](i,nj-2);
+} // namespace
+
+// The helpers below work on a window of the grid's cells (the whole grid for
+// applyBoundaryConditions(Q)); Q holds cell (i, j) at (i - iBegin, j - jBegin).
+// A side is only set where the window reaches it. Both ghost layers are set,
+// the second one (i = -1 or ni, j = -1 or nj) in the state's margin.
+template <typename Real>
+void Initialize::imposeBoundaryConditions(BasicFlowState<Real> &Q, const Tile &window, bool parallel) const {
+    if (boundary[WEST] == BoundaryType::Inlet) {
+        setInletConditions(Q, window, parallel);
+    }
+    if (boundary[EAST] == BoundaryType::Outlet) {
+        setOutletConditions(Q, window, parallel);
     }
+    setWallConditions(Q, window, parallel, boundary[SOUTH] == BoundaryType::Wall, boundary[NORTH] == BoundaryType::Wall);
 }
 
-Eigen::MatrixXd Initialize::computePressure() const {
-    const auto &rho = Q[RHO].array();
-    const auto &rho_u = Q[RHO_U].array();
-    const auto &rho_v = Q[RHO_V].array();
-    const auto &energy = Q[ENERGY].array();
-
-    return ((gamma - 1.0)*(rho * energy - 0.5*rho*( (rho_u/rho).square() + (rho_v/rho).square() ))).matrix();
+template <typename Real>
+void Initialize::setInletConditions(BasicFlowState<Real> &Q, const Tile &window, bool parallel) const {
+    // supersonic inflow: prescribe all freestream -> write into i=0 and i=-1 ghosts
+    if (window.iBegin != 0) {
+        return;
+    }
+    boundaryLoop(parallel, 0, window.jEnd - window.jBegin, [&](int j) {
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            Q(k, 0, j) = static_cast<Real>(Qinf[k]);
+            Q(k, -1, j) = static_cast<Real>(Qinf[k]);
+        }
+    });
 }
 
-Eigen::MatrixXd Initialize::computeTemp() const {
-    Eigen::MatrixXd P = computePressure();
-    return (P.array() / Q[RHO].array() / R).matrix();
+template <typename Real>
+void Initialize::setOutletConditions(BasicFlowState<Real> &Q, const Tile &window, bool parallel) const {
+    // supersonic outflow: zero‐gradient -> copy last interior into both ghosts
+    const int ni = grid.getCellNX();
+    if (window.iEnd != ni || window.iEnd - window.iBegin < 2) {
+        return;
+    }
+    const int ghost = ni - 1 - window.iBegin;
+    boundaryLoop(parallel, 0, window.jEnd - window.jBegin, [&](int j) {
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            Q(k, ghost, j) = Q(k, ghost - 1, j);
+            Q(k, ghost + 1, j) = Q(k, ghost - 1, j);
+        }
+    });
 }
 
-Eigen::MatrixXd Initialize::computeU_Velo() const {
-    return (Q[RHO_V].array() / Q[RHO].array()).matrix();
+template <typename Real>
+void Initialize::setWallConditions(BasicFlowState<Real> &Q, const Tile &window, bool parallel,
+                                   bool south, bool north) const {
+    // inviscid slip wall on top/bottom: mirror the velocity about the wall
+    // face so the normal component flips and the tangential one is kept
+    const int nj = grid.getCellNY();
+    const Eigen::MatrixXd &Sx = grid.getXAreaEta();
+    const Eigen::MatrixXd &Sy = grid.getYAreaEta();
+    south = south && window.jBegin == 0 && window.jEnd - window.jBegin >= 2;
+    north = north && window.jEnd == nj && window.jEnd - window.jBegin >= 2;
+    if (!south && !north) {
+        return;
+    }
+
+    auto reflect = [&](int i, int jGhost, int jIn, int face) {
+        // corner ghosts borrow the normal of the nearest wall face
+        const int fi = std::clamp(window.iBegin + i - 1, 0, static_cast<int>(Sx.rows()) - 1);
+        const double len = std::hypot(Sx(fi, face), Sy(fi, face));
+        const double nx = Sx(fi, face) / len;
+        const double ny = Sy(fi, face) / len;
+        const double mn = Q(RHO_U, i, jIn) * nx + Q(RHO_V, i, jIn) * ny;
+
+        Q(RHO, i, jGhost) = Q(RHO, i, jIn);
+        Q(RHO_U, i, jGhost) = static_cast<Real>(Q(RHO_U, i, jIn) - 2.0 * mn * nx);
+        Q(RHO_V, i, jGhost) = static_cast<Real>(Q(RHO_V, i, jIn) - 2.0 * mn * ny);
+        Q(ENERGY, i, jGhost) = Q(ENERGY, i, jIn);
+    };
+
+    // bottom (j=0) and top (j=jmax-1); the second layer mirrors the next
+    // interior cell across the same face when the window holds it
+    const int top = nj - 1 - window.jBegin;
+    const bool deep = window.jEnd - window.jBegin >= 3;
+    boundaryLoop(parallel, 0, window.iEnd - window.iBegin, [&](int i) {
+        // bottom wall: j=0 mirrors j=1 across eta face 1, j=-1 mirrors j=2
+        if (south) {
+            reflect(i, 0, 1, 0);
+            if (deep) {
+                reflect(i, -1, 2, 0);
+            }
+        }
+
+        // top wall: j=nj-1 mirrors j=nj-2 across eta face nj-1, j=nj mirrors j=nj-3
+        if (north) {
+            reflect(i, top, top - 1, static_cast<int>(Sx.cols()) - 1);
+            if (deep) {
+                reflect(i, top + 1, top - 2, static_cast<int>(Sx.cols()) - 1);
+            }
+        }
+    });
 }
 
-Eigen::MatrixXd Initialize::computeV_Velo() const {
-    return (Q[RHO_U].array() / Q[RHO].array()).matrix();
+template void Initialize::applyBoundaryConditions(FlowState &Q) const;
+template void Initialize::applyBoundaryConditions(FlowStateF &Q) const;
+template void Initialize::applyBoundaryConditions(FlowState &W, const Tile &window) const;
+template void Initialize::applyBoundaryConditions(FlowStateF &W, const Tile &window) const;
+
+const PrimitiveState &Initialize::computePrimitives() {
+    primitives.compute(state, gamma, R);
+    return primitives;
 }
@@ -0,0 +1,289 @@
+#include "LUSGS.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+// Forward-mode dual number: a value plus N directional derivatives. Running
+// splitFlux on it gives the exact linearization of the split flux; the
+// eigenvector form R diag(lambda±) L drops the d(lambda±)/dQ terms and makes
+// the factorization unstable at large CFL on subsonic faces.
+template <int N>
+struct Dual {
+    double v = 0.0;
+    std::array<double, N> d{};
+
+    Dual() = default;
+    Dual(double value) : v(value) { }
+
+    Dual &operator+=(const Dual &b) {
+        v += b.v;
+        for (int k = 0; k < N; ++k) d[k] += b.d[k];
+        return *this;
+    }
+};
+
+template <int N>
+Dual<N> operator+(const Dual<N> &a, const Dual<N> &b) {
+    Dual<N> r(a.v + b.v);
+    for (int k = 0; k < N; ++k) r.d[k] = a.d[k] + b.d[k];
+    return r;
+}
+
+template <int N>
+Dual<N> operator-(const Dual<N> &a, const Dual<N> &b) {
+    Dual<N> r(a.v - b.v);
+    for (int k = 0; k < N; ++k) r.d[k] = a.d[k] - b.d[k];
+    return r;
+}
+
+template <int N>
+Dual<N> operator*(const Dual<N> &a, const Dual<N> &b) {
+    Dual<N> r(a.v * b.v);
+    for (int k = 0; k < N; ++k) r.d[k] = a.d[k] * b.v + a.v * b.d[k];
+    return r;
+}
+
+template <int N>
+Dual<N> operator/(const Dual<N> &a, const Dual<N> &b) {
+    Dual<N> r(a.v / b.v);
+    for (int k = 0; k < N; ++k) r.d[k] = (a.d[k] - r.v * b.d[k]) / b.v;
+    return r;
+}
+
+template <int N> Dual<N> operator+(const Dual<N> &a, double b) { return a + Dual<N>(b); }
+template <int N> Dual<N> operator-(const Dual<N> &a, double b) { return a - Dual<N>(b); }
+template <int N> Dual<N> operator*(double a, const Dual<N> &b) { return Dual<N>(a) * b; }
+template <int N> Dual<N> operator*(const Dual<N> &a, double b) { return a * Dual<N>(b); }
+template <int N> Dual<N> operator/(const Dual<N> &a, double b) { return a * (1.0 / b); }
+
+template <int N>
+Dual<N> sqrt(const Dual<N> &a) {
+    Dual<N> r(std::sqrt(a.v));
+    for (int k = 0; k < N; ++k) r.d[k] = 0.5 * a.d[k] / r.v;
+    return r;
+}
+
+template <int N>
+Dual<N> fabs(const Dual<N> &a) {
+    return a.v < 0.0 ? Dual<N>(0.0) - a : a;
+}
+
+// J += d/dq of the split flux of state q through one face
+void addSplitJacobian(double gamma, double sign, const double *q,
+                      double nx, double ny, double len, Eigen::Matrix4d &J) {
+    Dual<4> s[4], f[4];
+    for (int k = 0; k < 4; ++k) {
+        s[k] = Dual<4>(q[k]);
+        s[k].d[k] = 1.0;
+    }
+    splitFlux(gamma, sign, s[0], s[1], s[2], s[3], nx, ny, len, f[0], f[1], f[2], f[3]);
+    for (int m = 0; m < 4; ++m) {
+        for (int k = 0; k < 4; ++k) {
+            J(m, k) += f[m].d[k];
+        }
+    }
+}
+
+// out += (d/dq of the split flux of state q through one face) dq
+void addSplitProduct(double gamma, double sign, const double *q,
+                     double nx, double ny, double len,
+                     const double *dq, double *out) {
+    Dual<1> s[4], f[4];
+    for (int k = 0; k < 4; ++k) {
+        s[k] = Dual<1>(q[k]);
+        s[k].d[0] = dq[k];
+    }
+    splitFlux(gamma, sign, s[0], s[1], s[2], s[3], nx, ny, len, f[0], f[1], f[2], f[3]);
+    for (int m = 0; m < 4; ++m) {
+        out[m] += f[m].d[0];
+    }
+}
+
+inline void loadCell(const FlowState &Q, int i, int j, double *q) {
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        q[k] = Q(k, i, j);
+    }
+}
+
+} // namespace
+
+LUSGS::LUSGS(const FluxSolver &flux_, const std::array<BoundaryType, 4> &boundary_,
+             int jacobianInterval_)
+  : flux(flux_), boundary(boundary_), gamma(flux_.getGamma()),
+    ni(flux_.getNI()), nj(flux_.getNJ()), jacobianInterval(std::max(jacobianInterval_, 1))
+{
+    dQ.resize(ni, nj);
+    stride = dQ.getStride();
+    // blocks are left uninitialized here and first written by the tile sweeps
+    faceJacobian.resize(dQ.getPlaneSize());
+    Dinv.resize(dQ.getPlaneSize());
+}
+
+void LUSGS::buildFaceJacobians(const FlowState &Q, const Tile &tile) {
+    const FaceMetrics &xi = flux.getXiFaces();
+    const FaceMetrics &eta = flux.getEtaFaces();
+
+    for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+        for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+            const std::size_t c = static_cast<std::size_t>(j) * stride + i;
+            double q[4];
+            loadCell(Q, i, j, q);
+
+            Eigen::Matrix4d &J = faceJacobian[c];
+            J.setZero();
+
+            // outward faces: +xi / +eta use A+(n), -xi / -eta use -A-(n)
+            addSplitJacobian(gamma, 1.0, q, xi.rowNX(j)[i + 1], xi.rowNY(j)[i + 1], xi.rowLen(j)[i + 1], J);
+            addSplitJacobian(gamma, -1.0, q, xi.rowNX(j)[i], xi.rowNY(j)[i], -xi.rowLen(j)[i], J);
+            addSplitJacobian(gamma, 1.0, q, eta.rowNX(j + 1)[i], eta.rowNY(j + 1)[i], eta.rowLen(j + 1)[i], J);
+            addSplitJacobian(gamma, -1.0, q, eta.rowNX(j)[i], eta.rowNY(j)[i], -eta.rowLen(j)[i], J);
+
+            // slip walls: the ghost state is the mirror image M q of this cell,
+            // so its split flux through the wall face couples back through M
+            auto wall = [&](int jf, int jg, double sign, double len) {
+                const double nx = eta.rowNX(jf)[i];
+                const double ny = eta.rowNY(jf)[i];
+                Eigen::Matrix4d M = Eigen::Matrix4d::Identity();
+                M(1, 1) -= 2.0 * nx * nx;
+                M(1, 2) -= 2.0 * nx * ny;
+                M(2, 1) -= 2.0 * ny * nx;
+                M(2, 2) -= 2.0 * ny * ny;
+                double g[4];
+                loadCell(Q, i, jg, g);
+                Eigen::Matrix4d Jg = Eigen::Matrix4d::Zero();
+                addSplitJacobian(gamma, sign, g, nx, ny, len, Jg);
+                J += Jg * M;
+            };
+            if (j == 1 && boundary[SOUTH] == BoundaryType::Wall) {
+                wall(1, 0, 1.0, -eta.rowLen(1)[i]);
+            }
+            if (j == nj - 2 && boundary[NORTH] == BoundaryType::Wall) {
+                wall(nj - 1, nj - 1, -1.0, eta.rowLen(nj - 1)[i]);
+            }
+
+            // zero-gradient outlet: the ghost copies this cell (inter-block
+            // ghosts are lagged, i.e. treated explicitly)
+            if (i == ni - 2 && boundary[EAST] == BoundaryType::Outlet) {
+                addSplitJacobian(gamma, -1.0, q, xi.rowNX(j)[i + 1], xi.rowNY(j)[i + 1], xi.rowLen(j)[i + 1], J);
+            }
+        }
+    }
+}
+
+void LUSGS::buildDiagonal(const FlowState &Q, const AlignedVector<double> &dt,
+                          const AlignedVector<double> &invVolume) {
+    const bool relinearize = updates % jacobianInterval == 0;
+    ++updates;
+
+    forEachTile(flux.getTiles(), [&](const Tile &tile) {
+        if (relinearize) {
+            buildFaceJacobians(Q, tile);
+        }
+        for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+            for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+                const std::size_t c = static_cast<std::size_t>(j) * stride + i;
+                Eigen::Matrix4d D = faceJacobian[c];
+                D.diagonal().array() += 1.0 / (dt[c] * invVolume[c]);
+                Dinv[c] = D.inverse();
+            }
+        }
+    });
+}
+
+void LUSGS::forwardSweep(const FlowState &Q, const FlowState &R, const Tile &tile) {
+    const FaceMetrics &xi = flux.getXiFaces();
+    const FaceMetrics &eta = flux.getEtaFaces();
+
+    // dQ* = D^-1 (-R + A+_{i-1} dQ*_{i-1} + B+_{j-1} dQ*_{j-1})
+    for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+        for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+            double rhs[4], q[4], d[4];
+            for (int k = 0; k < 4; ++k) {
+                rhs[k] = -R(k, i, j);
+            }
+            if (i > 1) {
+                loadCell(Q, i - 1, j, q);
+                loadCell(dQ, i - 1, j, d);
+                addSplitProduct(gamma, 1.0, q, xi.rowNX(j)[i], xi.rowNY(j)[i], xi.rowLen(j)[i], d, rhs);
+            }
+            if (j > 1) {
+                loadCell(Q, i, j - 1, q);
+                loadCell(dQ, i, j - 1, d);
+                addSplitProduct(gamma, 1.0, q, eta.rowNX(j)[i], eta.rowNY(j)[i], eta.rowLen(j)[i], d, rhs);
+            }
+            const Eigen::Vector4d x = Dinv[static_cast<std::size_t>(j) * stride + i] *
+                                      Eigen::Vector4d(rhs[0], rhs[1], rhs[2], rhs[3]);
+            for (int k = 0; k < 4; ++k) {
+                dQ(k, i, j) = x[k];
+            }
+        }
+    }
+}
+
+void LUSGS::backwardSweep(const FlowState &Q, const Tile &tile) {
+    const FaceMetrics &xi = flux.getXiFaces();
+    const FaceMetrics &eta = flux.getEtaFaces();
+
+    // dQ = dQ* - D^-1 (A-_{i+1} dQ_{i+1} + B-_{j+1} dQ_{j+1})
+    for (int j = tile.jEnd - 1; j >= tile.jBegin; --j) {
+        for (int i = tile.iEnd - 1; i >= tile.iBegin; --i) {
+            double rhs[4] = {0.0, 0.0, 0.0, 0.0}, q[4], d[4];
+            if (i < ni - 2) {
+                loadCell(Q, i + 1, j, q);
+                loadCell(dQ, i + 1, j, d);
+                addSplitProduct(gamma, -1.0, q, xi.rowNX(j)[i + 1], xi.rowNY(j)[i + 1], xi.rowLen(j)[i + 1], d, rhs);
+            }
+            if (j < nj - 2) {
+                loadCell(Q, i, j + 1, q);
+                loadCell(dQ, i, j + 1, d);
+                addSplitProduct(gamma, -1.0, q, eta.rowNX(j + 1)[i], eta.rowNY(j + 1)[i], eta.rowLen(j + 1)[i], d, rhs);
+            }
+            const Eigen::Vector4d x = Dinv[static_cast<std::size_t>(j) * stride + i] *
+                                      Eigen::Vector4d(rhs[0], rhs[1], rhs[2], rhs[3]);
+            for (int k = 0; k < 4; ++k) {
+                dQ(k, i, j) -= x[k];
+            }
+        }
+    }
+}
+
+void LUSGS::update(FlowState &Q, const FlowState &R, const AlignedVector<double> &dt,
+                   const AlignedVector<double> &invVolume) {
+    const TileDecomposition &tiles = flux.getTiles();
+
+    buildDiagonal(Q, dt, invVolume);
+
+    // the sweeps are Gauss-Seidel in both directions: tiles run as wavefronts,
+    // which reproduces the serial sweep exactly
+    forEachTileWavefront(tiles, true, [&](const Tile &tile) { forwardSweep(Q, R, tile); });
+    forEachTileWavefront(tiles, false, [&](const Tile &tile) { backwardSweep(Q, tile); });
+
+    // large steps can overshoot during the start-up transient: scale dQ per
+    // cell so density and pressure change by at most maxChange
+    const double maxChange = 0.2;
+    forEachTile(tiles, [&](const Tile &tile) {
+        for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+            for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+                double q[4], d[4];
+                loadCell(Q, i, j, q);
+                loadCell(dQ, i, j, d);
+                const double P = (gamma - 1.0) * (q[3] - 0.5 * (q[1] * q[1] + q[2] * q[2]) / q[0]);
+                const double r = q[0] + d[0];
+                const double Pn = (gamma - 1.0) * (q[3] + d[3] - 0.5 * ((q[1] + d[1]) * (q[1] + d[1]) +
+                                                                      (q[2] + d[2]) * (q[2] + d[2])) / r);
+                double alpha = 1.0;
+                if (std::fabs(d[0]) > maxChange * q[0]) {
+                    alpha = std::min(alpha, maxChange * q[0] / std::fabs(d[0]));
+                }
+                if (!(r > 0.0) || std::fabs(Pn - P) > maxChange * P) {
+                    alpha = std::min(alpha, maxChange * P / std::max(std::fabs(Pn - P), 1e-300));
+                }
+                for (int k = 0; k < FlowState::NVAR; ++k) {
+                    Q(k, i, j) += alpha * d[k];
+                }
+            }
+        }
+    });
+}
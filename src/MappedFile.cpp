@@ -0,0 +1,74 @@
+#include "MappedFile.h"
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define EULER_HAVE_MMAP 1
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string &filename) {
+    close();
+
+#if defined(EULER_HAVE_MMAP)
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        std::cerr << "Failed to stat file: " << filename << "\n";
+        return false;
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    if (length > 0) {
+        void *p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            std::cerr << "Failed to map file: " << filename << "\n";
+            return false;
+        }
+        // the parsers stream through the file once
+        ::madvise(p, length, MADV_SEQUENTIAL);
+        ptr = static_cast<const char *>(p);
+        mapped = true;
+    }
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return true;
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    length = static_cast<std::size_t>(file.tellg());
+    buffer.resize(length);
+    file.seekg(0);
+    file.read(buffer.data(), static_cast<std::streamsize>(length));
+    ptr = buffer.data();
+    return static_cast<bool>(file);
+#endif
+}
+
+void MappedFile::close() {
+#if defined(EULER_HAVE_MMAP)
+    if (mapped && ptr) {
+        ::munmap(const_cast<char *>(ptr), length);
+    }
+#endif
+    ptr = nullptr;
+    length = 0;
+    mapped = false;
+    buffer.clear();
+}
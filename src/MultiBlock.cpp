@@ -0,0 +1,292 @@
+#include "MultiBlock.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+MultiBlock::MultiBlock(const GridHandler &global, double R, double gamma, double Cp, MPI_Comm comm_)
+  : comm(comm_)
+{
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    // only rank 0 holds the global grid
+    int cells[2] = {global.getCellNX(), global.getCellNY()};
+    MPI_Bcast(cells, 2, MPI_INT, 0, comm);
+    decomposition = BlockDecomposition(cells[0], cells[1], size);
+    if (decomposition.getBlockCount() != size) {
+        MPI_Abort(comm, 1);
+    }
+    block = decomposition.getBlock(rank);
+
+    // rank 0 cuts the nodes of every block, ghost layer included, and sends
+    // them as x then y (column-major, like Eigen)
+    auto nodeCount = [](const Block &b) {
+        return std::array<int, 2>{b.iEnd - b.iBegin + 3, b.jEnd - b.jBegin + 3};
+    };
+    if (rank == 0) {
+        for (int r = 1; r < size; ++r) {
+            const Block &b = decomposition.getBlock(r);
+            const auto [nx, ny] = nodeCount(b);
+            std::vector<double> nodes(2 * static_cast<std::size_t>(nx) * ny);
+            Eigen::Map<Eigen::MatrixXd>(nodes.data(), nx, ny) =
+                global.getX().block(b.iBegin - 1, b.jBegin - 1, nx, ny);
+            Eigen::Map<Eigen::MatrixXd>(nodes.data() + nodes.size() / 2, nx, ny) =
+                global.getY().block(b.iBegin - 1, b.jBegin - 1, nx, ny);
+            MPI_Send(nodes.data(), static_cast<int>(nodes.size()), MPI_DOUBLE, r, 0, comm);
+        }
+        if (!grid.extractBlock(global, block.iBegin, block.iEnd, block.jBegin, block.jEnd)) {
+            MPI_Abort(comm, 1);
+        }
+    } else {
+        const auto [nx, ny] = nodeCount(block);
+        std::vector<double> nodes(2 * static_cast<std::size_t>(nx) * ny);
+        MPI_Recv(nodes.data(), static_cast<int>(nodes.size()), MPI_DOUBLE, 0, 0, comm, MPI_STATUS_IGNORE);
+        grid.setBlockNodes(Eigen::Map<Eigen::MatrixXd>(nodes.data(), nx, ny),
+                           Eigen::Map<Eigen::MatrixXd>(nodes.data() + nodes.size() / 2, nx, ny));
+    }
+
+    // physical sides keep the single-block BCs, cut sides exchange halos
+    init = std::make_unique<Initialize>(grid, R, gamma, Cp);
+    std::array<BoundaryType, 4> types = init->getBoundaryTypes();
+    for (int side = 0; side < 4; ++side) {
+        if (block.neighbour[side] >= 0) {
+            types[side] = BoundaryType::InterBlock;
+        }
+    }
+    init->setBoundaryTypes(types);
+
+    for (int side = 0; side < 4; ++side) {
+        if (block.neighbour[side] >= 0) {
+            const int cells = ghostStrip(side).count;
+            sendBuffer[side].assign(FlowState::NVAR * cells, 0.0);
+            recvBuffer[side].assign(FlowState::NVAR * cells, 0.0);
+        }
+    }
+}
+
+MultiBlock::~MultiBlock() {
+    // never leave requests dangling on the communicator
+    if (!requests.empty()) {
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+    }
+}
+
+void MultiBlock::setInitialConditions(double P0, double T0, double M0) {
+    init->setInitialConditions(P0, T0, M0);
+}
+
+MultiBlock::Strip MultiBlock::ghostStrip(int side) const {
+    const FlowState &Q = init->getState();
+    const int ni = Q.getNI();
+    const int nj = Q.getNJ();
+    const int stride = Q.getStride();
+    switch (side) {
+        case WEST:  return {stride, stride, nj - 2};
+        case EAST:  return {stride + ni - 1, stride, nj - 2};
+        case SOUTH: return {1, 1, ni - 2};
+        default:    return {(nj - 1) * stride + 1, 1, ni - 2};
+    }
+}
+
+MultiBlock::Strip MultiBlock::interiorStrip(int side) const {
+    const FlowState &Q = init->getState();
+    const int stride = Q.getStride();
+    Strip s = ghostStrip(side);
+    switch (side) {
+        case WEST:  s.first += 1; break;
+        case EAST:  s.first -= 1; break;
+        case SOUTH: s.first += stride; break;
+        default:    s.first -= stride; break;
+    }
+    return s;
+}
+
+void MultiBlock::beginExchange(FlowState &Q) {
+    requests.clear();
+    for (int side = 0; side < 4; ++side) {
+        const int other = block.neighbour[side];
+        if (other < 0) {
+            continue;
+        }
+        const int count = FlowState::NVAR * ghostStrip(side).count;
+
+        // the neighbour receives this side on its opposite one, which is the tag
+        const Strip s = interiorStrip(side);
+        double *buffer = sendBuffer[side].data();
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            const double *Qk = Q.plane(k);
+            for (int n = 0; n < s.count; ++n) {
+                buffer[k * s.count + n] = Qk[s.first + n * s.step];
+            }
+        }
+
+        requests.emplace_back();
+        MPI_Irecv(recvBuffer[side].data(), count, MPI_DOUBLE, other, side, comm, &requests.back());
+        requests.emplace_back();
+        MPI_Isend(buffer, count, MPI_DOUBLE, other, side ^ 1, comm, &requests.back());
+    }
+}
+
+void MultiBlock::finishExchange(FlowState &Q) {
+    if (!requests.empty()) {
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+        requests.clear();
+    }
+    for (int side = 0; side < 4; ++side) {
+        if (block.neighbour[side] < 0) {
+            continue;
+        }
+        const Strip s = ghostStrip(side);
+        const double *buffer = recvBuffer[side].data();
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            double *Qk = Q.plane(k);
+            for (int n = 0; n < s.count; ++n) {
+                Qk[s.first + n * s.step] = buffer[k * s.count + n];
+            }
+        }
+    }
+}
+
+ResidualNorms MultiBlock::reduceNorms(const ResidualNorms &sums, double cells) {
+    // gather every block's partial sums and add them in rank order, so the
+    // global norms do not depend on the reduction tree of the MPI library
+    constexpr int n = 2 * FlowState::NVAR + 1;
+    double local[n];
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        local[k] = sums.L2[k];
+        local[FlowState::NVAR + k] = sums.Linf[k];
+    }
+    local[n - 1] = cells;
+
+    std::vector<double> all(static_cast<std::size_t>(n) * size);
+    MPI_Allgather(local, n, MPI_DOUBLE, all.data(), n, MPI_DOUBLE, comm);
+
+    ResidualNorms norms;
+    double totalCells = 0.0;
+    for (int r = 0; r < size; ++r) {
+        const double *part = all.data() + static_cast<std::size_t>(r) * n;
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            norms.L2[k] += part[k];
+            norms.Linf[k] = std::max(norms.Linf[k], part[FlowState::NVAR + k]);
+        }
+        totalCells += part[n - 1];
+    }
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        norms.L2[k] = std::sqrt(norms.L2[k] / totalCells);
+    }
+    return norms;
+}
+
+double MultiBlock::reduceMin(double value) {
+    double result = value;
+    MPI_Allreduce(&value, &result, 1, MPI_DOUBLE, MPI_MIN, comm);
+    return result;
+}
+
+bool MultiBlock::run(const SolverOptions &options) {
+    // the norms are global, so every rank takes the same decisions; only the
+    // root prints
+    SolverOptions local = options;
+    local.printInterval = 0;
+    local.precision = Precision::Double; // the halo exchange sends the double state
+    local.fusedSweep = false;            // the residual overlaps the halo exchange instead
+    local.freezeSettled = false;         // ghosts change with the neighbours' updates
+    if (rank == 0 && options.reconstruction != Reconstruction::FirstOrder) {
+        std::cerr << "Multi-block runs exchange one ghost layer, running with first-order fluxes\n";
+    }
+    local.reconstruction = Reconstruction::FirstOrder; // one layer of ghosts is exchanged
+    solver = std::make_unique<Solver>(grid, *init, local);
+    solver->setCoupling(this);
+    const ResidualMonitor &monitor = solver->getMonitor();
+    FlowState &Q = init->getState();
+
+    auto refreshGhosts = [&]() {
+        init->applyBoundaryConditions();
+        beginExchange(Q);
+        finishExchange(Q);
+    };
+
+    for (int n = 0; n < options.maxIterations; ++n) {
+        const ResidualNorms &norms = solver->iterate();
+
+        if (rank == 0 && options.printInterval > 0 && n % options.printInterval == 0) {
+            std::cout << "iter " << std::setw(6) << n
+                      << std::scientific << std::setprecision(4)
+                      << "  L2(rho) " << norms.L2[0]
+                      << "  Linf(rho) " << norms.Linf[0]
+                      << "  rel " << monitor.relativeL2()
+                      << std::defaultfloat << "\n";
+        }
+        if (monitor.converged()) {
+            refreshGhosts();
+            if (rank == 0) {
+                std::cout << "Converged after " << monitor.getIterations() << " iterations on "
+                          << size << " blocks\n";
+            }
+            return true;
+        }
+        if (monitor.diverged()) {
+            if (rank == 0) {
+                std::cerr << "Residual diverged after " << monitor.getIterations() << " iterations\n";
+            }
+            return false;
+        }
+        if (monitor.stalled()) {
+            break;
+        }
+    }
+    refreshGhosts();
+    if (rank == 0) {
+        std::cout << "Stopped after " << monitor.getIterations() << " iterations without converging\n";
+    }
+    return false;
+}
+
+void MultiBlock::gather(Initialize *global, int root) const {
+    const FlowState &Q = init->getState();
+    const int cellsI = block.iEnd - block.iBegin;
+    const int cellsJ = block.jEnd - block.jBegin;
+
+    // interior cells of this block, variable by variable
+    std::vector<double> local(static_cast<std::size_t>(FlowState::NVAR) * cellsI * cellsJ);
+    std::size_t n = 0;
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        for (int j = 1; j <= cellsJ; ++j) {
+            for (int i = 1; i <= cellsI; ++i) {
+                local[n++] = Q(k, i, j);
+            }
+        }
+    }
+
+    std::vector<int> counts(size), offsets(size);
+    for (int r = 0; r < size; ++r) {
+        const Block &b = decomposition.getBlock(r);
+        counts[r] = FlowState::NVAR * (b.iEnd - b.iBegin) * (b.jEnd - b.jBegin);
+        offsets[r] = r > 0 ? offsets[r - 1] + counts[r - 1] : 0;
+    }
+    std::vector<double> all;
+    if (rank == root) {
+        all.resize(static_cast<std::size_t>(offsets[size - 1]) + counts[size - 1]);
+    }
+    MPI_Gatherv(local.data(), static_cast<int>(local.size()), MPI_DOUBLE,
+                all.data(), counts.data(), offsets.data(), MPI_DOUBLE, root, comm);
+    if (rank != root) {
+        return;
+    }
+
+    FlowState &G = global->getState();
+    for (int r = 0; r < size; ++r) {
+        const Block &b = decomposition.getBlock(r);
+        const double *part = all.data() + offsets[r];
+        std::size_t m = 0;
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            for (int j = b.jBegin; j < b.jEnd; ++j) {
+                for (int i = b.iBegin; i < b.iEnd; ++i) {
+                    G(k, i, j) = part[m++];
+                }
+            }
+        }
+    }
+    global->applyBoundaryConditions();
+}
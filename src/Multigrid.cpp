@@ -0,0 +1,319 @@
+#include "Multigrid.h"
+#include "Checkpoint.h"
+#include "SolutionWriter.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+Multigrid::Multigrid(const GridHandler &grid, Initialize &init,
+                     const SolverOptions &solverOptions,
+                     const MultigridOptions &options_,
+                     const std::vector<std::unique_ptr<GridHandler>> *coarseGrids)
+  : options(options_),
+    monitor(solverOptions.tolerance, solverOptions.stallWindow, solverOptions.stallRatio)
+{
+    // the residual of the last post-smoothing step, taken after the coarse
+    // grid correction, is what every cycle is judged on
+    options.preSmooth = std::max(options.preSmooth, 0);
+    if (options.postSmooth < 1) {
+        std::cerr << "Multigrid needs a post-smoothing step for its residual, smoothing once\n";
+        options.postSmooth = 1;
+    }
+    std::vector<std::unique_ptr<GridHandler>> owned;
+    if (!coarseGrids) {
+        owned = agglomerateLevels(grid, options);
+        coarseGrids = &owned;
+    }
+    levels.reserve(coarseGrids->size() + 1);
+
+    // restriction and prolongation work on the double states of the levels
+    SolverOptions levelOptions = solverOptions;
+    levelOptions.precision = Precision::Double;
+    levelOptions.temporalSteps = 1; // one smoothing step per iterate()
+    levelOptions.freezeSettled = false; // corrections and forcing change every cycle
+
+    Level fine;
+    fine.grid = &grid;
+    fine.init = &init;
+    fine.solver = std::make_unique<Solver>(grid, init, levelOptions);
+    levels.push_back(std::move(fine));
+
+    const double fineCells = static_cast<double>(grid.getCellNX() - 2) * (grid.getCellNY() - 2);
+
+    for (std::size_t n = 0; n < coarseGrids->size(); ++n) {
+        Level coarse;
+        if (coarseGrids == &owned) {
+            coarse.ownedGrid = std::move(owned[n]);
+            coarse.grid = coarse.ownedGrid.get();
+        } else {
+            coarse.grid = (*coarseGrids)[n].get();
+        }
+        coarse.ownedInit = std::make_unique<Initialize>(*coarse.grid, init.getR(), init.getGamma(), init.getCp());
+        coarse.init = coarse.ownedInit.get();
+        coarse.init->setFreestream(init.getFreestream());
+        coarse.init->setBoundaryTypes(init.getBoundaryTypes());
+        coarse.solver = std::make_unique<Solver>(*coarse.grid, *coarse.init, levelOptions);
+
+        const FlowState &Q = coarse.init->getState();
+        coarse.forcing.resize(Q.getNI(), Q.getNJ());
+        coarse.restricted.resize(Q.getNI(), Q.getNJ());
+        coarse.workPerSweep = static_cast<double>(Q.getNI() - 2) * (Q.getNJ() - 2) / fineCells;
+        levels.push_back(std::move(coarse));
+    }
+}
+
+std::vector<std::unique_ptr<GridHandler>> Multigrid::agglomerateLevels(const GridHandler &grid,
+                                                                       const MultigridOptions &options) {
+    std::vector<std::unique_ptr<GridHandler>> coarse;
+
+    // agglomerate 2:1 until the requested depth, or until the grid no longer
+    // pairs up or would get too coarse to represent the flow features
+    while (static_cast<int>(coarse.size()) + 1 < options.levels) {
+        const GridHandler &parent = coarse.empty() ? grid : *coarse.back();
+        if ((parent.getCellNX() - 2) / 2 < options.minCells ||
+            (parent.getCellNY() - 2) / 2 < options.minCells) {
+            break;
+        }
+
+        auto level = std::make_unique<GridHandler>();
+        if (!level->agglomerate(parent)) {
+            break;
+        }
+        coarse.push_back(std::move(level));
+    }
+    return coarse;
+}
+
+void Multigrid::smooth(int level, int steps) {
+    Level &L = levels[level];
+    for (int n = 0; n < steps; ++n) {
+        L.solver->iterate();
+    }
+    workUnits += steps * L.workPerSweep * L.solver->getStageCount();
+}
+
+void Multigrid::restrictToCoarse(int level, bool withForcing) {
+    Level &F = levels[level];
+    Level &C = levels[level + 1];
+    const FlowState &Qf = F.init->getState();
+    FlowState &Qc = C.init->getState();
+    const Eigen::MatrixXd &Vf = F.grid->getCellVolume();
+    const Eigen::MatrixXd &Vc = C.grid->getCellVolume();
+
+    // volume-weighted average of the 2x2 children
+    parallelFor(1, Qc.getNJ() - 1, [&](int J) {
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            for (int I = 1; I < Qc.getNI() - 1; ++I) {
+                double sum = 0.0;
+                for (int j = 2 * J - 1; j <= 2 * J; ++j) {
+                    for (int i = 2 * I - 1; i <= 2 * I; ++i) {
+                        sum += Vf(i, j) * Qf(k, i, j);
+                    }
+                }
+                Qc(k, I, J) = sum / Vc(I, J);
+            }
+        }
+    });
+    C.init->applyBoundaryConditions();
+    C.restricted.copyFrom(Qc);
+
+    if (!withForcing) {
+        C.solver->setForcing(nullptr);
+        return;
+    }
+
+    // FAS forcing: P_c = R_c(I Q_f) - sum over children of (R_f - P_f)
+    const FlowState &Rf = F.solver->evaluateResidual();
+    C.solver->setForcing(nullptr);
+    const FlowState &Rc = C.solver->evaluateResidual();
+    parallelFor(1, Qc.getNJ() - 1, [&](int J) {
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            for (int I = 1; I < Qc.getNI() - 1; ++I) {
+                const double sum = Rf(k, 2 * I - 1, 2 * J - 1) + Rf(k, 2 * I, 2 * J - 1) +
+                                   Rf(k, 2 * I - 1, 2 * J) + Rf(k, 2 * I, 2 * J);
+                C.forcing(k, I, J) = Rc(k, I, J) - sum;
+            }
+        }
+    });
+    C.solver->setForcing(&C.forcing);
+}
+
+void Multigrid::prolongateCorrection(int level) {
+    Level &F = levels[level];
+    Level &C = levels[level + 1];
+    FlowState &Qf = F.init->getState();
+    const FlowState &Qc = C.init->getState();
+    const double gamma = F.init->getGamma();
+
+    // halo corrections follow from the BCs applied to both coarse states
+    C.init->applyBoundaryConditions();
+
+    parallelFor(1, Qf.getNJ() - 1, [&](int j) {
+        const int J = (j + 1) / 2;
+        const int dJ = (j % 2 == 1) ? -1 : 1;
+        for (int i = 1; i < Qf.getNI() - 1; ++i) {
+            const int I = (i + 1) / 2;
+            const int dI = (i % 2 == 1) ? -1 : 1;
+
+            // bilinear weights 9/16, 3/16, 3/16, 1/16 towards the nearest coarse cells
+            double q[FlowState::NVAR];
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                auto dq = [&](int a, int b) { return Qc(k, a, b) - C.restricted(k, a, b); };
+                q[k] = Qf(k, i, j) + (9.0 * dq(I, J) + 3.0 * dq(I + dI, J) +
+                                      3.0 * dq(I, J + dJ) + dq(I + dI, J + dJ)) / 16.0;
+            }
+
+            // drop corrections that would leave a non-physical state
+            const double P = (gamma - 1.0) * (q[3] - 0.5 * (q[1] * q[1] + q[2] * q[2]) / q[0]);
+            if (q[0] > 0.0 && P > 0.0) {
+                for (int k = 0; k < FlowState::NVAR; ++k) {
+                    Qf(k, i, j) = q[k];
+                }
+            }
+        }
+    });
+}
+
+void Multigrid::cycle(int level) {
+    const int coarsest = getLevels() - 1;
+    if (level == coarsest) {
+        smooth(level, options.coarseSmooth);
+        return;
+    }
+
+    smooth(level, options.preSmooth);
+    restrictToCoarse(level, true);
+
+    // the coarsest level is visited once per parent visit in either cycle type
+    const int visits = (level + 1 == coarsest) ? 1 : options.cycleIndex;
+    for (int n = 0; n < visits; ++n) {
+        cycle(level + 1);
+    }
+
+    prolongateCorrection(level);
+    smooth(level, options.postSmooth);
+}
+
+void Multigrid::solveLevel(int level, int cycles) {
+    for (int n = 0; n < cycles; ++n) {
+        cycle(level);
+    }
+}
+
+bool Multigrid::run() {
+    const int nLevels = getLevels();
+    const SolverOptions &solverOptions = levels[0].solver->getOptions();
+    const int printInterval = solverOptions.printInterval;
+
+    if (options.fullMultigrid && nLevels > 1 && !restarted) {
+        // FMG: converge roughly on each coarse level, then carry the change up
+        for (int l = 0; l < nLevels - 1; ++l) {
+            restrictToCoarse(l, false);
+        }
+        for (int l = nLevels - 1; l > 0; --l) {
+            solveLevel(l, options.fmgCycles);
+            prolongateCorrection(l - 1);
+        }
+    }
+
+    // checkpoints and solution files of the fine state go to disk on background threads
+    std::unique_ptr<CheckpointWriter> checkpoint;
+    if (solverOptions.checkpointInterval > 0) {
+        checkpoint = std::make_unique<CheckpointWriter>(*levels[0].grid, solverOptions.checkpointFile,
+                                                        levels[0].init->getGamma());
+    }
+    std::unique_ptr<SolutionWriter> output;
+    if (solverOptions.output.enabled) {
+        output = std::make_unique<SolutionWriter>(*levels[0].grid, levels[0].init->getR(), levels[0].init->getGamma(), solverOptions.output);
+    }
+    auto finalOutput = [&]() {
+        if (!solverOptions.profile.report.empty()) {
+            Profiler::writeReport(solverOptions.profile.report);
+        }
+        if (checkpoint) {
+            checkpoint->submit(levels[0].init->getState(), monitor.getIterations(), monitor.getHistory());
+        }
+        if (output) {
+            output->submit(levels[0].init->getState(), monitor.getIterations());
+        }
+        if (checkpoint) {
+            checkpoint->wait();
+        }
+        if (output) {
+            output->wait();
+        }
+    };
+
+    for (int n = monitor.getIterations(); n < options.maxCycles; ++n) {
+        cycle(0);
+        Profiler::countIteration();
+        const ResidualNorms &norms = monitor.record(levels[0].solver->getMonitor().getLast());
+
+        if (printInterval > 0 && n % printInterval == 0) {
+            std::cout << "cycle " << std::setw(5) << n
+                      << std::scientific << std::setprecision(4)
+                      << "  L2(rho) " << norms.L2[0]
+                      << "  rel " << monitor.relativeL2()
+                      << std::defaultfloat << std::setprecision(6)
+                      << "  work " << workUnits << "\n";
+        }
+        if (Profiler::enabled() && solverOptions.profile.interval > 0 && n % solverOptions.profile.interval == 0) {
+            Profiler::printLine(std::cout, n);
+        }
+        if (monitor.converged()) {
+            levels[0].init->applyBoundaryConditions();
+            finalOutput();
+            std::cout << "Converged after " << monitor.getIterations() << " cycles ("
+                      << workUnits << " work units)\n";
+            return true;
+        }
+        if (monitor.diverged()) {
+            std::cerr << "Multigrid diverged after " << monitor.getIterations() << " cycles\n";
+            if (!solverOptions.profile.report.empty()) {
+                Profiler::writeReport(solverOptions.profile.report);
+            }
+            return false;
+        }
+        if (monitor.stalled()) {
+            break;
+        }
+        if (checkpoint && monitor.getIterations() % solverOptions.checkpointInterval == 0) {
+            checkpoint->submit(levels[0].init->getState(), monitor.getIterations(), monitor.getHistory());
+        }
+        if (output && solverOptions.output.interval > 0 && monitor.getIterations() % solverOptions.output.interval == 0) {
+            output->submit(levels[0].init->getState(), monitor.getIterations());
+        }
+    }
+    levels[0].init->applyBoundaryConditions();
+    finalOutput();
+    std::cout << "Multigrid stopped after " << monitor.getIterations() << " cycles without converging\n";
+    return false;
+}
+
+bool Multigrid::restart(const std::string &filename) {
+    CheckpointInfo info;
+    if (!readCheckpoint(filename, *levels[0].grid, levels[0].init->getState(), info)) {
+        return false;
+    }
+    if (info.sameGrid) {
+        monitor.restore(info.history);
+    } else if (!info.history.empty()) {
+        // warm start on another grid: keep judging convergence against the
+        // cold start of the run that wrote the checkpoint
+        monitor.setReference(info.history.front());
+    }
+    levels[0].init->applyBoundaryConditions();
+    restarted = true;
+    return true;
+}
+
+bool Multigrid::warmStart(const FlowState &Q0) {
+    if (!levels[0].solver->warmStart(Q0)) {
+        return false;
+    }
+    monitor.reset();
+    monitor.setReference(levels[0].solver->getMonitor().getReference());
+    restarted = true;
+    return true;
+}
@@ -0,0 +1,53 @@
+#include "Parallel.h"
+#include <algorithm>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+int getThreadCount() {
+#if defined(_OPENMP)
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+int getThreadIndex() {
+#if defined(_OPENMP)
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+void setThreadCount(int threads) {
+#if defined(_OPENMP)
+    omp_set_num_threads(std::max(threads, 1));
+#else
+    (void)threads;
+#endif
+}
+
+TileDecomposition::TileDecomposition() : tilesI(0), tilesJ(0) { }
+
+TileDecomposition::TileDecomposition(int ni, int nj, int tileNI, int tileNJ) {
+    const int cellsI = std::max(ni - 2, 0);
+    const int cellsJ = std::max(nj - 2, 0);
+    tileNI = tileNI > 0 ? tileNI : std::max(cellsI, 1);
+    tileNJ = tileNJ > 0 ? tileNJ : std::max(cellsJ, 1);
+    tilesI = (cellsI + tileNI - 1) / tileNI;
+    tilesJ = (cellsJ + tileNJ - 1) / tileNJ;
+
+    tiles.reserve(static_cast<std::size_t>(tilesI) * tilesJ);
+    for (int b = 0; b < tilesJ; ++b) {
+        for (int a = 0; a < tilesI; ++a) {
+            Tile t;
+            t.iBegin = 1 + a * tileNI;
+            t.iEnd = std::min(t.iBegin + tileNI, ni - 1);
+            t.jBegin = 1 + b * tileNJ;
+            t.jEnd = std::min(t.jBegin + tileNJ, nj - 1);
+            tiles.push_back(t);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#include "PrimitiveState.h"
+#include <cmath>
+#include "Parallel.h"
+
+PrimitiveState::PrimitiveState() : ni(0), nj(0), stride(0), planeSize(0) { }
+
+void PrimitiveState::resize(int ni_, int nj_) {
+    if (ni_ == ni && nj_ == nj) {
+        return;
+    }
+    ni = ni_;
+    nj = nj_;
+    stride = ((ni + FlowState::PAD - 1) / FlowState::PAD) * FlowState::PAD;
+    planeSize = static_cast<std::size_t>(stride) * nj;
+    data.clear();
+    data.resize(NFIELD * planeSize);
+}
+
+void PrimitiveState::compute(const FlowState &Q, double gamma, double R) {
+    resize(Q.getNI(), Q.getNJ());
+
+    // zero density (unset halo corners) gives zero fields rather than NaNs
+    parallelFor(0, nj, [&](int j) {
+        const double *rho = Q.row(0, j);
+        const double *rhoU = Q.row(1, j);
+        const double *rhoV = Q.row(2, j);
+        const double *E = Q.row(3, j);
+        double *P = row(PRESSURE, j);
+        double *T = row(TEMPERATURE, j);
+        double *u = row(U_VELO, j);
+        double *v = row(V_VELO, j);
+        double *a = row(SOUND_SPEED, j);
+        for (int i = 0; i < ni; ++i) {
+            const double inv = rho[i] != 0.0 ? 1.0 / rho[i] : 0.0;
+            const double ui = rhoU[i] * inv;
+            const double vi = rhoV[i] * inv;
+            const double Pi = (gamma - 1.0) * (E[i] - 0.5 * rho[i] * (ui * ui + vi * vi));
+            P[i] = Pi;
+            T[i] = Pi * inv / R;
+            u[i] = ui;
+            v[i] = vi;
+            a[i] = std::sqrt(gamma * Pi * inv);
+        }
+    });
+}
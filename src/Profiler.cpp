@@ -0,0 +1,302 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include "Parallel.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+std::atomic<bool> Profiler::active{false};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr int nPhases = static_cast<int>(Phase::Count);
+
+// timers and counters per thread, on cache lines of their own so timers
+// running at once (sweep cases, flux rows) neither share lines nor a lock.
+// Slots go by OS thread, not OpenMP thread index, as several solvers (sweep
+// cases) may run their own thread teams at once; threads beyond maxSlots
+// share a slot, which the atomic adds keep exact.
+struct alignas(64) ThreadSlot {
+    std::atomic<double> seconds[nPhases] = {};
+    std::atomic<long long> calls[nPhases] = {};
+    std::atomic<long long> iterations{0};
+    std::atomic<long long> cellUpdates{0};
+    std::atomic<double> construction{0.0}; // flux work inside residual sweeps
+    std::atomic<double> differencing{0.0};
+};
+constexpr int maxSlots = 256;
+ThreadSlot threadSlots[maxSlots];
+std::atomic<int> nextSlot{0};
+
+ThreadSlot &threadSlot() {
+    thread_local ThreadSlot &slot = threadSlots[nextSlot.fetch_add(1, std::memory_order_relaxed) % maxSlots];
+    return slot;
+}
+
+template <typename T>
+void accumulate(std::atomic<T> &total, T value) {
+    total.fetch_add(value, std::memory_order_relaxed);
+}
+
+struct Totals {
+    double seconds[nPhases] = {};
+    long long calls[nPhases] = {};
+    long long iterations = 0;
+    long long cellUpdates = 0;
+    long long allocations = 0;
+    long long allocatedBytes = 0;
+    double wall = 0.0;
+};
+
+std::mutex lineMutex;    // guards lastLine and started
+Totals lastLine;         // totals at the previous printLine
+Clock::time_point started = Clock::now();
+
+// running heap counters, never reset (reset() records a base instead)
+std::atomic<long long> allocCount{0};
+std::atomic<long long> allocBytes{0};
+long long allocBase = 0;
+long long allocBytesBase = 0;
+
+// sums of the per-thread flux work
+void fluxWork(double &construction, double &differencing) {
+    construction = 0.0;
+    differencing = 0.0;
+    for (const ThreadSlot &s : threadSlots) {
+        construction += s.construction.load(std::memory_order_relaxed);
+        differencing += s.differencing.load(std::memory_order_relaxed);
+    }
+}
+
+// current totals summed over the threads, with the wall clock and heap
+// counters filled in (lineMutex held)
+Totals current() {
+    Totals t;
+    for (const ThreadSlot &s : threadSlots) {
+        for (int p = 0; p < nPhases; ++p) {
+            t.seconds[p] += s.seconds[p].load(std::memory_order_relaxed);
+            t.calls[p] += s.calls[p].load(std::memory_order_relaxed);
+        }
+        t.iterations += s.iterations.load(std::memory_order_relaxed);
+        t.cellUpdates += s.cellUpdates.load(std::memory_order_relaxed);
+    }
+    t.wall = std::chrono::duration<double>(Clock::now() - started).count();
+    t.allocations = allocCount.load(std::memory_order_relaxed) - allocBase;
+    t.allocatedBytes = allocBytes.load(std::memory_order_relaxed) - allocBytesBase;
+    return t;
+}
+
+// reported phases: the residual sweep is split by the threads' flux work
+struct Row {
+    const char *name;
+    double seconds;
+    long long calls;
+};
+
+std::vector<Row> rows(const Totals &t) {
+    double construction, differencing;
+    fluxWork(construction, differencing);
+    const double work = construction + differencing;
+    const double share = work > 0.0 ? construction / work : 0.5;
+    const double residual = t.seconds[static_cast<int>(Phase::Residual)];
+    const long long sweeps = t.calls[static_cast<int>(Phase::Residual)];
+
+    auto phase = [&](const char *name, Phase p) {
+        return Row{name, t.seconds[static_cast<int>(p)], t.calls[static_cast<int>(p)]};
+    };
+    std::vector<Row> result = {
+        phase("grid_read", Phase::GridRead),
+        phase("cell_metrics", Phase::CellMetrics),
+        phase("boundary", Phase::Boundary),
+        Row{"flux_construction", residual * share, sweeps},
+        Row{"flux_differencing", residual * (1.0 - share), sweeps},
+        phase("time_step", Phase::TimeStep),
+        phase("update", Phase::Update),
+        phase("norms", Phase::Norms),
+        phase("fused_step", Phase::Fused),
+        phase("output", Phase::Output),
+    };
+    double timed = 0.0;
+    for (const Row &r : result) {
+        timed += r.seconds;
+    }
+    result.push_back(Row{"other", std::max(t.wall - timed, 0.0), 0});
+    return result;
+}
+
+} // namespace
+
+void Profiler::setEnabled(bool on) {
+    active.store(on, std::memory_order_relaxed);
+}
+
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(lineMutex);
+    lastLine = Totals();
+    for (ThreadSlot &s : threadSlots) {
+        for (int p = 0; p < nPhases; ++p) {
+            s.seconds[p].store(0.0, std::memory_order_relaxed);
+            s.calls[p].store(0, std::memory_order_relaxed);
+        }
+        s.iterations.store(0, std::memory_order_relaxed);
+        s.cellUpdates.store(0, std::memory_order_relaxed);
+        s.construction.store(0.0, std::memory_order_relaxed);
+        s.differencing.store(0.0, std::memory_order_relaxed);
+    }
+    started = Clock::now();
+    allocBase = allocCount.load(std::memory_order_relaxed);
+    allocBytesBase = allocBytes.load(std::memory_order_relaxed);
+}
+
+void Profiler::add(Phase phase, double seconds) {
+    ThreadSlot &s = threadSlot();
+    accumulate(s.seconds[static_cast<int>(phase)], seconds);
+    accumulate(s.calls[static_cast<int>(phase)], 1LL);
+}
+
+void Profiler::addFluxWork(double construction, double differencing) {
+    ThreadSlot &s = threadSlot();
+    accumulate(s.construction, construction);
+    accumulate(s.differencing, differencing);
+}
+
+void Profiler::countIteration() {
+    if (!enabled()) {
+        return;
+    }
+    accumulate(threadSlot().iterations, 1LL);
+}
+
+void Profiler::countCellUpdates(long long cells) {
+    if (!enabled()) {
+        return;
+    }
+    accumulate(threadSlot().cellUpdates, cells);
+}
+
+void Profiler::countAllocation(std::size_t bytes) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(static_cast<long long>(bytes), std::memory_order_relaxed);
+}
+
+long long Profiler::getAllocations() {
+    return allocCount.load(std::memory_order_relaxed) - allocBase;
+}
+
+long long Profiler::getAllocatedBytes() {
+    return allocBytes.load(std::memory_order_relaxed) - allocBytesBase;
+}
+
+long long Profiler::getPeakMemory() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<long long>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<long long>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
+
+void Profiler::printLine(std::ostream &out, int iteration) {
+    std::lock_guard<std::mutex> lock(lineMutex);
+    const Totals now = current();
+    Totals delta = now;
+    delta.wall -= lastLine.wall;
+    delta.iterations -= lastLine.iterations;
+    delta.cellUpdates -= lastLine.cellUpdates;
+    delta.allocations -= lastLine.allocations;
+    for (int p = 0; p < nPhases; ++p) {
+        delta.seconds[p] -= lastLine.seconds[p];
+    }
+    lastLine = now;
+
+    const double wall = delta.wall > 0.0 ? delta.wall : 1.0;
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    auto percent = [&](Phase p) { return 100.0 * delta.seconds[static_cast<int>(p)] / wall; };
+    out << "profile " << std::setw(6) << iteration << std::fixed << std::setprecision(1)
+        << "  " << delta.iterations / wall << " it/s"
+        << "  " << delta.cellUpdates / wall * 1e-6 << " Mcell/s"
+        << "  bc " << percent(Phase::Boundary) << "%"
+        << "  flux " << percent(Phase::Residual) << "%"
+        << "  dt " << percent(Phase::TimeStep) << "%"
+        << "  update " << percent(Phase::Update) << "%"
+        << "  norms " << percent(Phase::Norms) << "%"
+        << "  fused " << percent(Phase::Fused) << "%"
+        << "  output " << percent(Phase::Output) << "%"
+        << "  allocs " << delta.allocations
+        << "  peak " << getPeakMemory() / (1024.0 * 1024.0) << " MB\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool Profiler::writeReport(const std::string &prefix) {
+    Totals t;
+    {
+        std::lock_guard<std::mutex> lock(lineMutex);
+        t = current();
+    }
+    const std::vector<Row> phases = rows(t);
+    const double wall = t.wall > 0.0 ? t.wall : 1.0;
+    const long long peak = getPeakMemory();
+
+    std::ofstream json(prefix + ".json", std::ios::trunc);
+    std::ofstream csv(prefix + ".csv", std::ios::trunc);
+    if (!json.is_open() || !csv.is_open()) {
+        std::cerr << "Failed to open profile report: " << prefix << ".json/.csv\n";
+        return false;
+    }
+    json << std::setprecision(9);
+    csv << std::setprecision(9);
+
+    json << "{\n  \"format\": \"euler_profile\",\n  \"version\": 1,\n"
+         << "  \"threads\": " << getThreadCount() << ",\n"
+         << "  \"wall_seconds\": " << t.wall << ",\n"
+         << "  \"iterations\": " << t.iterations << ",\n"
+         << "  \"iterations_per_s\": " << t.iterations / wall << ",\n"
+         << "  \"cell_updates\": " << t.cellUpdates << ",\n"
+         << "  \"cell_updates_per_s\": " << t.cellUpdates / wall << ",\n"
+         << "  \"allocations\": " << t.allocations << ",\n"
+         << "  \"allocated_bytes\": " << t.allocatedBytes << ",\n"
+         << "  \"peak_memory_bytes\": " << peak << ",\n"
+         << "  \"phases\": {\n";
+    csv << "metric,value\n"
+        << "threads," << getThreadCount() << "\n"
+        << "wall_seconds," << t.wall << "\n"
+        << "iterations," << t.iterations << "\n"
+        << "iterations_per_s," << t.iterations / wall << "\n"
+        << "cell_updates," << t.cellUpdates << "\n"
+        << "cell_updates_per_s," << t.cellUpdates / wall << "\n"
+        << "allocations," << t.allocations << "\n"
+        << "allocated_bytes," << t.allocatedBytes << "\n"
+        << "peak_memory_bytes," << peak << "\n";
+    for (std::size_t n = 0; n < phases.size(); ++n) {
+        const Row &r = phases[n];
+        json << "    \"" << r.name << "\": {\"seconds\": " << r.seconds << ", \"calls\": " << r.calls
+             << ", \"fraction\": " << r.seconds / wall << "}" << (n + 1 < phases.size() ? ",\n" : "\n");
+        csv << "phase." << r.name << ".seconds," << r.seconds << "\n"
+            << "phase." << r.name << ".calls," << r.calls << "\n"
+            << "phase." << r.name << ".fraction," << r.seconds / wall << "\n";
+    }
+    json << "  }\n}\n";
+
+    if (!json || !csv) {
+        std::cerr << "Failed to write profile report: " << prefix << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#include "SnapshotQueue.h"
+#include "Profiler.h"
+
+SnapshotQueue::SnapshotQueue(std::function<bool(const Snapshot &)> write_)
+  : write(std::move(write_))
+{
+    worker = std::thread(&SnapshotQueue::writerLoop, this);
+}
+
+SnapshotQueue::~SnapshotQueue() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return ready < 0 && writing < 0; });
+        stop = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void SnapshotQueue::submit(const FlowState &Q, int iteration, const std::vector<ResidualNorms> *history) {
+    ScopedTimer timer(Phase::Output);
+    int target;
+    {
+        // take the buffer the thread is not writing; a snapshot still queued
+        // there is stale now and simply overwritten
+        std::lock_guard<std::mutex> lock(mutex);
+        target = writing == 0 ? 1 : 0;
+        if (ready == target) {
+            ready = -1;
+            ++dropped;
+        }
+    }
+
+    Snapshot &s = buffers[target];
+    if (s.Q.getNI() != Q.getNI() || s.Q.getNJ() != Q.getNJ()) {
+        s.Q.resize(Q.getNI(), Q.getNJ());
+    }
+    s.Q.copyFrom(Q);
+    s.iteration = iteration;
+    if (history) {
+        s.history = *history;
+    } else {
+        s.history.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = target;
+    }
+    cv.notify_all();
+}
+
+bool SnapshotQueue::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return ready < 0 && writing < 0; });
+    return ok;
+}
+
+void SnapshotQueue::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cv.wait(lock, [&] { return stop || ready >= 0; });
+        if (ready < 0) {
+            return; // stopped with nothing queued
+        }
+        writing = ready;
+        ready = -1;
+        lock.unlock();
+
+        const bool success = write(buffers[writing]);
+
+        lock.lock();
+        ok = ok && success;
+        written += success ? 1 : 0;
+        writing = -1;
+        cv.notify_all();
+    }
+}
@@ -0,0 +1,196 @@
+#include "SolutionWriter.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// output fields, cell-centred
+constexpr int nFields = 8;
+constexpr const char *fieldNames[nFields] = {"rho", "rhoU", "rhoV", "rhoE", "P", "T", "u", "v"};
+
+// node lines 1, 1 + d, 1 + 2d, ... of the interior nodes, always ending on the last one
+std::vector<int> keptLines(int nodes, int d) {
+    std::vector<int> lines;
+    const int last = nodes - 2;
+    for (int n = 1; n < last; n += d) {
+        lines.push_back(n);
+    }
+    lines.push_back(last);
+    return lines;
+}
+
+std::string frameName(const std::string &prefix, int iteration, const char *extension) {
+    std::string digits = std::to_string(iteration);
+    if (digits.size() < 6) {
+        digits.insert(0, 6 - digits.size(), '0');
+    }
+    return prefix + "_" + digits + extension;
+}
+
+} // namespace
+
+SolutionWriter::SolutionWriter(const GridHandler &grid, double R_, double gamma_, const OutputOptions &options_)
+  : options(options_), R(R_), gamma(gamma_),
+    lineI(keptLines(grid.getNX(), std::max(options_.decimation, 1))),
+    lineJ(keptLines(grid.getNY(), std::max(options_.decimation, 1))),
+    queue([this](const Snapshot &s) { return writeSnapshot(s); })
+{
+    pointX.reserve(lineI.size() * lineJ.size());
+    pointY.reserve(lineI.size() * lineJ.size());
+    for (int j : lineJ) {
+        for (int i : lineI) {
+            pointX.push_back(static_cast<float>(grid.getX()(i, j)));
+            pointY.push_back(static_cast<float>(grid.getY()(i, j)));
+        }
+    }
+}
+
+std::string SolutionWriter::fileName(int iteration, const char *extension) const {
+    return frameName(options.prefix, iteration, extension);
+}
+
+void SolutionWriter::sampleFields(const FlowState &Q, std::vector<float> &fields) const {
+    const int mI = static_cast<int>(lineI.size()) - 1;
+    const int mJ = static_cast<int>(lineJ.size()) - 1;
+    const std::size_t cells = static_cast<std::size_t>(mI) * mJ;
+    fields.assign(nFields * cells, 0.0f);
+
+    for (int b = 0; b < mJ; ++b) {
+        for (int a = 0; a < mI; ++a) {
+            // cell i lies between node lines i and i + 1
+            double sum[nFields] = {};
+            for (int j = lineJ[b]; j < lineJ[b + 1]; ++j) {
+                for (int i = lineI[a]; i < lineI[a + 1]; ++i) {
+                    const double rho = Q(0, i, j);
+                    const double u = Q(1, i, j) / rho;
+                    const double v = Q(2, i, j) / rho;
+                    const double P = (gamma - 1.0) * (Q(3, i, j) - 0.5 * rho * (u * u + v * v));
+                    const double values[nFields] = {rho, Q(1, i, j), Q(2, i, j), Q(3, i, j), P, P / (rho * R), u, v};
+                    for (int f = 0; f < nFields; ++f) {
+                        sum[f] += values[f];
+                    }
+                }
+            }
+            const double count = static_cast<double>(lineI[a + 1] - lineI[a]) * (lineJ[b + 1] - lineJ[b]);
+            for (int f = 0; f < nFields; ++f) {
+                fields[f * cells + static_cast<std::size_t>(b) * mI + a] = static_cast<float>(sum[f] / count);
+            }
+        }
+    }
+}
+
+bool SolutionWriter::writeSnapshot(const Snapshot &s) const {
+    std::vector<float> fields;
+    sampleFields(s.Q, fields);
+
+    bool ok = true;
+    if (options.vtk) {
+        ok = writeVTK(frameName(options.prefix, s.iteration, ".vts"), fields) && ok;
+    }
+    if (options.tecplot) {
+        ok = writeTecplot(frameName(options.prefix, s.iteration, ".dat"), fields, s.iteration) && ok;
+    }
+    return ok;
+}
+
+bool SolutionWriter::writeVTK(const std::string &filename, const std::vector<float> &fields) const {
+    const std::size_t points = pointX.size();
+    const std::size_t cells = fields.size() / nFields;
+    const std::uint64_t pointBytes = 3 * points * sizeof(float);
+    const std::uint64_t fieldBytes = cells * sizeof(float);
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+
+    // XML header, then every array as raw appended data (UInt64 size + values)
+    const std::string extent = "0 " + std::to_string(lineI.size() - 1) + " 0 " +
+                               std::to_string(lineJ.size() - 1) + " 0 0";
+    file << "<?xml version=\"1.0\"?>\n"
+         << "<VTKFile type=\"StructuredGrid\" version=\"1.0\" byte_order=\""
+         << (std::endian::native == std::endian::little ? "LittleEndian" : "BigEndian")
+         << "\" header_type=\"UInt64\">\n"
+         << "  <StructuredGrid WholeExtent=\"" << extent << "\">\n"
+         << "    <Piece Extent=\"" << extent << "\">\n"
+         << "      <Points>\n"
+         << "        <DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"appended\" offset=\"0\"/>\n"
+         << "      </Points>\n"
+         << "      <CellData Scalars=\"P\">\n";
+    std::uint64_t offset = sizeof(std::uint64_t) + pointBytes;
+    for (int f = 0; f < nFields; ++f) {
+        file << "        <DataArray type=\"Float32\" Name=\"" << fieldNames[f]
+             << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+        offset += sizeof(std::uint64_t) + fieldBytes;
+    }
+    file << "      </CellData>\n"
+         << "    </Piece>\n"
+         << "  </StructuredGrid>\n"
+         << "  <AppendedData encoding=\"raw\">\n_";
+
+    std::vector<float> xyz(3 * points, 0.0f);
+    for (std::size_t n = 0; n < points; ++n) {
+        xyz[3 * n] = pointX[n];
+        xyz[3 * n + 1] = pointY[n];
+    }
+    file.write(reinterpret_cast<const char *>(&pointBytes), sizeof(pointBytes));
+    file.write(reinterpret_cast<const char *>(xyz.data()), static_cast<std::streamsize>(pointBytes));
+    for (int f = 0; f < nFields; ++f) {
+        file.write(reinterpret_cast<const char *>(&fieldBytes), sizeof(fieldBytes));
+        file.write(reinterpret_cast<const char *>(fields.data() + f * cells), static_cast<std::streamsize>(fieldBytes));
+    }
+    file << "\n  </AppendedData>\n</VTKFile>\n";
+
+    if (!file) {
+        std::cerr << "Failed to write solution: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool SolutionWriter::writeTecplot(const std::string &filename, const std::vector<float> &fields, int iteration) const {
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+
+    // block packing: nodes first, then the cell-centred fields
+    file << "TITLE = \"Euler solution, iteration " << iteration << "\"\n"
+         << "VARIABLES = \"x\" \"y\"";
+    for (int f = 0; f < nFields; ++f) {
+        file << " \"" << fieldNames[f] << "\"";
+    }
+    file << "\nZONE T=\"iteration " << iteration << "\", I=" << lineI.size() << ", J=" << lineJ.size()
+         << ", DATAPACKING=BLOCK, VARLOCATION=([3-" << 2 + nFields << "]=CELLCENTERED)\n";
+
+    // shortest round-trip text, 8 values per line
+    std::string text;
+    auto putBlock = [&](const float *values, std::size_t count) {
+        char buffer[32];
+        for (std::size_t n = 0; n < count; ++n) {
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), values[n]);
+            text.append(buffer, result.ptr);
+            text.push_back((n + 1) % 8 == 0 || n + 1 == count ? '\n' : ' ');
+        }
+        file << text;
+        text.clear();
+    };
+    const std::size_t cells = fields.size() / nFields;
+    putBlock(pointX.data(), pointX.size());
+    putBlock(pointY.data(), pointY.size());
+    for (int f = 0; f < nFields; ++f) {
+        putBlock(fields.data() + f * cells, cells);
+    }
+
+    if (!file) {
+        std::cerr << "Failed to write solution: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,728 @@
+#include "Solver.h"
+#include "Checkpoint.h"
+#include "SolutionWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+
+namespace {
+
+// mixed precision is only wired into the explicit updates
+Precision storagePrecision(const SolverOptions &options) {
+    return options.scheme != TimeScheme::LUSGS ? options.precision : Precision::Double;
+}
+
+// a and b of every stage of a multi-stage scheme
+struct StageCoefficients {
+    std::vector<double> a, b;
+};
+
+const StageCoefficients &stageCoefficients(StageScheme scheme) {
+    static const StageCoefficients jameson4{{1.0, 1.0, 1.0, 1.0}, {1.0 / 4.0, 1.0 / 3.0, 1.0 / 2.0, 1.0}};
+    static const StageCoefficients jameson5{{1.0, 1.0, 1.0, 1.0, 1.0},
+                                            {1.0 / 4.0, 1.0 / 6.0, 3.0 / 8.0, 1.0 / 2.0, 1.0}};
+    static const StageCoefficients upwind3{{1.0, 1.0, 1.0}, {0.1481, 0.4, 1.0}};
+    static const StageCoefficients upwind4{{1.0, 1.0, 1.0, 1.0}, {0.0833, 0.2069, 0.4265, 1.0}};
+    static const StageCoefficients upwind5{{1.0, 1.0, 1.0, 1.0, 1.0}, {0.0533, 0.1263, 0.2375, 0.4414, 1.0}};
+    static const StageCoefficients ssp3{{1.0, 3.0 / 4.0, 1.0 / 3.0}, {1.0, 1.0 / 4.0, 2.0 / 3.0}};
+    switch (scheme) {
+    case StageScheme::Jameson4: return jameson4;
+    case StageScheme::Jameson5: return jameson5;
+    case StageScheme::Upwind3: return upwind3;
+    case StageScheme::Upwind5: return upwind5;
+    case StageScheme::SSP3: return ssp3;
+    case StageScheme::Upwind4: break;
+    }
+    return upwind4;
+}
+
+// largest CFL that converged with MUSCL fluxes on the wedge, the smallest of
+// the three limiters (see the StageScheme table for first-order fluxes)
+double musclCflLimit(const SolverOptions &options) {
+    if (options.scheme == TimeScheme::ForwardEuler) {
+        return 0.3;
+    }
+    switch (options.stages) {
+    case StageScheme::Upwind4: return 1.8;
+    case StageScheme::Upwind5: return 2.0;
+    case StageScheme::Jameson4:
+    case StageScheme::Jameson5:
+    case StageScheme::Upwind3:
+    case StageScheme::SSP3: break;
+    }
+    return 1.2;
+}
+
+// the fused sweep needs every cell's dt before the pass ends
+bool fusable(const SolverOptions &options) {
+    return options.scheme == TimeScheme::ForwardEuler && options.localTimeStep;
+}
+
+// a multiple of interval among the iterations [first, last)
+bool due(int first, int last, int interval) {
+    return interval > 0 && (first % interval == 0 || first / interval != (last - 1) / interval);
+}
+
+} // namespace
+
+Solver::Solver(const GridHandler &grid_, Initialize &init_, const SolverOptions &options_)
+  : grid(grid_), init(init_), options(options_),
+    flux(grid_, init_.getGamma(), options_.tileNI, options_.tileNJ, storagePrecision(options_),
+         options_.reconstruction, options_.limiter),
+    monitor(options_.tolerance, options_.stallWindow, options_.stallRatio)
+{
+    if (options.precision != storagePrecision(options)) {
+        std::cerr << "Mixed precision needs an explicit scheme, running in double\n";
+        options.precision = Precision::Double;
+    }
+    if (options.fusedSweep && !fusable(options)) {
+        std::cerr << "Fused sweep needs forward Euler with local time steps, running separate passes\n";
+        options.fusedSweep = false;
+    }
+    if (options.fusedSweep && options.reconstruction != Reconstruction::FirstOrder) {
+        std::cerr << "Fused sweep has first-order fluxes only, running separate passes\n";
+        options.fusedSweep = false;
+    }
+    if (options.reconstruction == Reconstruction::MUSCL && options.scheme != TimeScheme::LUSGS &&
+        options.cfl > musclCflLimit(options)) {
+        std::cerr << "MUSCL fluxes diverge or stall above cfl " << musclCflLimit(options)
+                  << " with this scheme, running at that\n";
+        options.cfl = musclCflLimit(options);
+    }
+    options.temporalSteps = std::max(options.temporalSteps, 1);
+    if (options.freezeSettled && !fusable(options)) {
+        std::cerr << "Freezing settled tiles needs forward Euler with local time steps, updating every cell\n";
+        options.freezeSettled = false;
+    }
+    if (options.freezeSettled && options.fusedSweep) {
+        std::cerr << "Freezing settled tiles runs the separate passes, fused sweep off\n";
+        options.fusedSweep = false;
+    }
+
+    // the MUSCL limiter measures jumps against the freestream
+    const std::array<double, 4> &Qinf = init.getFreestream();
+    if (Qinf[0] > 0.0) {
+        const double q2 = (Qinf[1] * Qinf[1] + Qinf[2] * Qinf[2]) / (Qinf[0] * Qinf[0]);
+        flux.setReferenceState(Qinf[0], std::sqrt(q2),
+                               (init.getGamma() - 1.0) * (Qinf[3] - 0.5 * Qinf[0] * q2));
+    }
+
+    const FlowState &Q = init.getState();
+    const int ni = Q.getNI();
+    const int nj = Q.getNJ();
+
+    // dt and 1 / V on the padded layout of the state, first touched row by
+    // row like the state
+    auto allocate = [&](auto &dtField, auto &ivField, int stride) {
+        using Real = typename std::remove_reference_t<decltype(dtField)>::value_type;
+        const std::size_t plane = static_cast<std::size_t>(stride) * nj;
+        dtField.resize(plane);
+        ivField.resize(plane);
+        const Eigen::MatrixXd &vol = grid.getCellVolume();
+        parallelFor(0, nj, [&](int j) {
+            Real *dtRow = dtField.data() + static_cast<std::size_t>(j) * stride;
+            Real *iv = ivField.data() + static_cast<std::size_t>(j) * stride;
+            std::fill_n(dtRow, stride, Real(0));
+            std::fill_n(iv, stride, Real(0));
+            for (int i = 0; i < ni; ++i) {
+                iv[i] = static_cast<Real>(1.0 / vol(i, j));
+            }
+        });
+    };
+
+    if (options.precision == Precision::Mixed) {
+        single = std::make_unique<SinglePrecision>();
+        single->Q.resize(ni, nj);
+        single->Q.copyFrom(Q);
+        if (options.fusedSweep) {
+            single->next.resize(ni, nj);
+            single->next.copyFrom(Q);
+        }
+        if (options.scheme == TimeScheme::RungeKutta) {
+            single->start.resize(ni, nj);
+        }
+        single->residual.resize(ni, nj);
+        allocate(single->dt, single->invVolume, single->Q.getStride());
+        return;
+    }
+
+    residual.resize(ni, nj);
+    allocate(dt, invVolume, Q.getStride());
+    if (options.fusedSweep) {
+        next.resize(ni, nj);
+        next.copyFrom(Q);
+    }
+    if (options.scheme == TimeScheme::RungeKutta) {
+        start.resize(ni, nj);
+    }
+
+    if (options.scheme == TimeScheme::LUSGS) {
+        implicit = std::make_unique<LUSGS>(flux, init.getBoundaryTypes(), options.jacobianInterval);
+    }
+}
+
+void Solver::computeTimeStep(const std::vector<unsigned char> *active) {
+    if (single) {
+        timeStep(single->Q, flux.getXiFacesF(), flux.getEtaFacesF(), single->invVolume, single->dt, active);
+    } else {
+        timeStep(init.getState(), flux.getXiFaces(), flux.getEtaFaces(), invVolume, dt, active);
+    }
+}
+
+template <typename Real>
+void Solver::timeStep(const BasicFlowState<Real> &Q, const BasicFaceMetrics<Real> &xi,
+                      const BasicFaceMetrics<Real> &eta, const AlignedVector<Real> &iVol,
+                      AlignedVector<Real> &dtField, const std::vector<unsigned char> *active) {
+    ScopedTimer timer(Phase::TimeStep);
+    const int stride = Q.getStride();
+    const double gamma = init.getGamma();
+    const double cfl = options.cfl;
+    const TileDecomposition &tiles = flux.getTiles();
+
+    // per-tile minima, combined serially below
+    tileMin.assign(tiles.getTileCount(), std::numeric_limits<double>::max());
+
+    parallelFor(0, tiles.getTileCount(), [&](int t) {
+        if (active && !(*active)[t]) {
+            return;
+        }
+        const Tile &tile = tiles.getTile(t);
+        double dtMin = std::numeric_limits<double>::max();
+        for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+            const Real *rho = Q.row(0, j);
+            const Real *rhoU = Q.row(1, j);
+            const Real *rhoV = Q.row(2, j);
+            const Real *E = Q.row(3, j);
+            const Real *xnx = xi.rowNX(j), *xny = xi.rowNY(j), *xl = xi.rowLen(j);
+            const Real *enx0 = eta.rowNX(j), *eny0 = eta.rowNY(j), *el0 = eta.rowLen(j);
+            const Real *enx1 = eta.rowNX(j + 1), *eny1 = eta.rowNY(j + 1), *el1 = eta.rowLen(j + 1);
+            const Real *iv = iVol.data() + static_cast<std::size_t>(j) * stride;
+            Real *dtRow = dtField.data() + static_cast<std::size_t>(j) * stride;
+
+            for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+                // cell-averaged face area vectors in xi and eta
+                const double sxX = 0.5 * (double(xnx[i]) * xl[i] + double(xnx[i + 1]) * xl[i + 1]);
+                const double sxY = 0.5 * (double(xny[i]) * xl[i] + double(xny[i + 1]) * xl[i + 1]);
+                const double seX = 0.5 * (double(enx0[i]) * el0[i] + double(enx1[i]) * el1[i]);
+                const double seY = 0.5 * (double(eny0[i]) * el0[i] + double(eny1[i]) * el1[i]);
+                const double lambda = spectralRadius(gamma, rho[i], rhoU[i], rhoV[i], E[i], sxX, sxY, seX, seY);
+
+                const double dtCell = cfl / (iv[i] * lambda);
+                dtRow[i] = static_cast<Real>(dtCell);
+                dtMin = std::min(dtMin, dtCell);
+            }
+        }
+        tileMin[t] = dtMin;
+    });
+
+    if (!options.localTimeStep) {
+        // global stepping: every cell advances with the most restrictive dt
+        double dtMin = *std::min_element(tileMin.begin(), tileMin.end());
+        if (coupling) {
+            dtMin = coupling->reduceMin(dtMin);
+        }
+        forEachTile(tiles, [&](const Tile &tile) {
+            for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+                Real *dtRow = dtField.data() + static_cast<std::size_t>(j) * stride;
+                std::fill(dtRow + tile.iBegin, dtRow + tile.iEnd, static_cast<Real>(dtMin));
+            }
+        });
+    }
+}
+
+const FlowState &Solver::evaluateResidual() {
+    if (single) {
+        // float sweep, widened for the callers (warm starts, diagnostics)
+        init.applyBoundaryConditions(single->Q);
+        flux.computeResidual(single->Q, single->residual);
+        if (residual.getNI() != single->residual.getNI() || residual.getNJ() != single->residual.getNJ()) {
+            residual.resize(single->residual.getNI(), single->residual.getNJ());
+        }
+        residual.copyFrom(single->residual);
+        return residual;
+    }
+
+    FlowState &Q = init.getState();
+    init.applyBoundaryConditions();
+
+    if (coupling) {
+        // the cells away from the block edges do not need the inter-block
+        // ghosts, so they are computed while the exchange is in flight
+        const int ni = Q.getNI();
+        const int nj = Q.getNJ();
+        coupling->beginExchange(Q);
+        flux.computeResidual(Q, residual, Tile{2, ni - 2, 2, nj - 2});
+        coupling->finishExchange(Q);
+        flux.computeResidual(Q, residual, Tile{1, ni - 1, 1, 2});
+        flux.computeResidual(Q, residual, Tile{1, ni - 1, nj - 2, nj - 1});
+        flux.computeResidual(Q, residual, Tile{1, 2, 2, nj - 2});
+        flux.computeResidual(Q, residual, Tile{ni - 2, ni - 1, 2, nj - 2});
+    } else {
+        flux.computeResidual(Q, residual);
+    }
+
+    if (forcing) {
+        forEachTile(flux.getTiles(), [&](const Tile &tile) {
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+                    const double *Pk = forcing->row(k, j);
+                    double *Rk = residual.row(k, j);
+                    for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+                        Rk[i] -= Pk[i];
+                    }
+                }
+            }
+        });
+    }
+    return residual;
+}
+
+const ResidualNorms &Solver::iterate() {
+    if (options.freezeSettled && !coupling && !forcing) {
+        if (single) {
+            return iterateActive(single->Q, single->residual, single->invVolume);
+        }
+        return iterateActive(init.getState(), residual, invVolume);
+    }
+    if (options.fusedSweep && !coupling) {
+        if (single) {
+            const ResidualNorms &norms = iterateFused(single->Q, single->next, single->invVolume);
+            single->Q.swap(single->next);
+            return norms;
+        }
+        const ResidualNorms &norms = iterateFused(init.getState(), next, invVolume);
+        init.swapState(next);
+        return norms;
+    }
+    if (options.scheme == TimeScheme::RungeKutta) {
+        return iterateStages();
+    }
+    if (single) {
+        return iterateMixed();
+    }
+    FlowState &Q = init.getState();
+
+    evaluateResidual();
+    computeTimeStep();
+    Profiler::countCellUpdates(static_cast<long long>(Q.getNI() - 2) * (Q.getNJ() - 2));
+    const ResidualNorms &norms = recordNorms();
+
+    ScopedTimer timer(Phase::Update);
+    if (implicit) {
+        implicit->update(Q, residual, dt, invVolume);
+        return norms;
+    }
+    update(Q, residual, dt, invVolume);
+    return norms;
+}
+
+const ResidualNorms &Solver::iterateMixed() {
+    FlowStateF &Q = single->Q;
+
+    init.applyBoundaryConditions(Q);
+    flux.computeResidual(Q, single->residual);
+    computeTimeStep();
+    Profiler::countCellUpdates(static_cast<long long>(Q.getNI() - 2) * (Q.getNJ() - 2));
+    const ResidualNorms &norms = recordNorms();
+
+    ScopedTimer timer(Phase::Update);
+    update(Q, single->residual, single->dt, single->invVolume);
+    return norms;
+}
+
+const ResidualNorms &Solver::iterateStages() {
+    const StageCoefficients &rk = stageCoefficients(options.stages);
+    const int nStages = static_cast<int>(rk.b.size());
+    const FlowState &Q = init.getState();
+    Profiler::countCellUpdates(static_cast<long long>(Q.getNI() - 2) * (Q.getNJ() - 2) * nStages);
+
+    // the norms and dt are those of Q_0, as in a forward Euler step; every
+    // stage sets the ghosts again before its residual
+    const ResidualNorms *recorded = nullptr;
+    for (int m = 0; m < nStages; ++m) {
+        if (single) {
+            init.applyBoundaryConditions(single->Q);
+            flux.computeResidual(single->Q, single->residual);
+        } else {
+            evaluateResidual();
+        }
+        if (m == 0) {
+            computeTimeStep();
+            recorded = &recordNorms();
+        }
+
+        ScopedTimer timer(Phase::Update);
+        if (single) {
+            stageUpdate(single->Q, single->start, single->residual, single->dt, single->invVolume,
+                        m == 0, rk.a[m], rk.b[m]);
+        } else {
+            stageUpdate(init.getState(), start, residual, dt, invVolume, m == 0, rk.a[m], rk.b[m]);
+        }
+    }
+    return *recorded;
+}
+
+int Solver::getStageCount() const {
+    if (options.scheme != TimeScheme::RungeKutta) {
+        return 1;
+    }
+    return static_cast<int>(stageCoefficients(options.stages).b.size());
+}
+
+const ResidualNorms &Solver::recordNorms() {
+    ScopedTimer timer(Phase::Norms);
+    if (single) {
+        return monitor.record(single->residual);
+    }
+    if (coupling) {
+        const double nCells = static_cast<double>(residual.getNI() - 2) * (residual.getNJ() - 2);
+        return monitor.record(coupling->reduceNorms(monitor.sums(residual), nCells));
+    }
+    return monitor.record(residual);
+}
+
+template <typename Real>
+void Solver::stageUpdate(BasicFlowState<Real> &Q, BasicFlowState<Real> &Q0, const BasicFlowState<Real> &R,
+                         const AlignedVector<Real> &dtField, const AlignedVector<Real> &iVol,
+                         bool first, double a, double b) {
+    const int stride = Q.getStride();
+
+    // Q_m = a Q_0 + (1 - a) Q_m-1 - b dt / V R; the first stage also saves Q_0
+    forEachTile(flux.getTiles(), [&](const Tile &tile) {
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+                const Real *Rk = R.row(k, j);
+                const Real *dtRow = dtField.data() + static_cast<std::size_t>(j) * stride;
+                const Real *iv = iVol.data() + static_cast<std::size_t>(j) * stride;
+                Real *Qk = Q.row(k, j);
+                Real *Q0k = Q0.row(k, j);
+                if (first) {
+                    for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+                        Q0k[i] = Qk[i];
+                        Qk[i] = static_cast<Real>(Qk[i] - b * dtRow[i] * iv[i] * Rk[i]);
+                    }
+                } else {
+                    for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+                        Qk[i] = static_cast<Real>(a * Q0k[i] + (1.0 - a) * Qk[i] - b * dtRow[i] * iv[i] * Rk[i]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <typename Real>
+const ResidualNorms &Solver::iterateFused(BasicFlowState<Real> &Q, BasicFlowState<Real> &next,
+                                          const AlignedVector<Real> &iVol) {
+    init.applyBoundaryConditions(Q);
+
+    // the last pass stops at maxIterations
+    FusedStep step;
+    step.cfl = options.cfl;
+    step.steps = std::clamp(options.maxIterations - monitor.getIterations(), 1, options.temporalSteps);
+    step.boundary = &init;
+    step.forcing = forcing;
+    flux.advance(Q, next, iVol, step, tileSums);
+
+    const double nCells = static_cast<double>(Q.getNI() - 2) * (Q.getNJ() - 2);
+    Profiler::countCellUpdates(static_cast<long long>(nCells) * step.steps);
+
+    ScopedTimer timer(Phase::Norms);
+    const std::size_t tiles = tileSums.size() / step.steps;
+    for (int m = 0; m < step.steps; ++m) {
+        recordTileSums(tileSums.data() + m * tiles, tiles, nCells);
+    }
+    return monitor.getLast();
+}
+
+template <typename Real>
+const ResidualNorms &Solver::iterateActive(BasicFlowState<Real> &Q, BasicFlowState<Real> &R,
+                                           const AlignedVector<Real> &iVol) {
+    const TileDecomposition &tiles = flux.getTiles();
+    const int count = tiles.getTileCount();
+    const int nI = tiles.getTilesI();
+    const int nJ = tiles.getTilesJ();
+    if (updated.size() != static_cast<std::size_t>(count)) {
+        // first step (or after a restart): every tile
+        updated.assign(count, 1);
+        tileSums.assign(count, ResidualNorms());
+    }
+
+    // a residual only changes where its stencil saw an update: in the tiles
+    // updated by the last step and their four neighbours. A MUSCL stencil
+    // reaches two cells, past a neighbour only one cell wide (the last tile
+    // of a band may be).
+    const int reach = flux.getReconstruction() == Reconstruction::MUSCL ? 2 : 1;
+    auto thin = [&](int a, int b, bool inI) {
+        const Tile &tile = tiles.getTile(a, b);
+        return (inI ? tile.iEnd - tile.iBegin : tile.jEnd - tile.jBegin) < reach;
+    };
+    evaluated.assign(count, 0);
+    for (int b = 0; b < nJ; ++b) {
+        for (int a = 0; a < nI; ++a) {
+            if (!updated[b * nI + a]) {
+                continue;
+            }
+            evaluated[b * nI + a] = 1;
+            for (int step : {-1, 1}) {
+                for (int n = a + step; n >= 0 && n < nI; n += step) {
+                    evaluated[b * nI + n] = 1;
+                    if (!thin(n, b, true)) {
+                        break;
+                    }
+                }
+                for (int n = b + step; n >= 0 && n < nJ; n += step) {
+                    evaluated[n * nI + a] = 1;
+                    if (!thin(a, n, false)) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    init.applyBoundaryConditions(Q);
+    flux.computeResidual(Q, R, evaluated);
+
+    const double nCells = static_cast<double>(Q.getNI() - 2) * (Q.getNJ() - 2);
+    {
+        // the other tiles keep their sums: neither their cells nor their
+        // neighbours changed, so R there is still that of the current Q
+        ScopedTimer timer(Phase::Norms);
+        parallelFor(0, count, [&](int t) {
+            if (!evaluated[t]) {
+                return;
+            }
+            const Tile &tile = tiles.getTile(t);
+            ResidualNorms &part = tileSums[t];
+            for (int k = 0; k < FlowState::NVAR; ++k) {
+                double sum = 0.0;
+                double peak = 0.0;
+                for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+                    const Real *Rk = R.row(k, j);
+                    for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+                        const double r = Rk[i];
+                        sum += r * r;
+                        peak = std::max(peak, std::fabs(r));
+                    }
+                }
+                part.L2[k] = sum;
+                part.Linf[k] = peak;
+            }
+        });
+        recordTileSums(tileSums.data(), tileSums.size(), nCells);
+    }
+
+    // a tile whose every |R| is below the threshold is frozen as it is, so
+    // its residual stays exact; the frozen cells together add less than
+    // freezeRatio * tolerance to the relative L2 norm
+    const ResidualNorms &reference = monitor.getReference();
+    long long active = 0;
+    for (int t = 0; t < count; ++t) {
+        bool settled = evaluated[t] != 0;
+        for (int k = 0; k < FlowState::NVAR && settled; ++k) {
+            settled = tileSums[t].Linf[k] < options.freezeRatio * options.tolerance * reference.L2[k];
+        }
+        updated[t] = evaluated[t] && !settled;
+        if (updated[t]) {
+            const Tile &tile = tiles.getTile(t);
+            active += static_cast<long long>(tile.iEnd - tile.iBegin) * (tile.jEnd - tile.jBegin);
+        }
+    }
+    activeFraction = active / nCells;
+    Profiler::countCellUpdates(active);
+
+    computeTimeStep(&updated);
+    ScopedTimer timer(Phase::Update);
+    if constexpr (std::is_same_v<Real, float>) {
+        update(Q, R, single->dt, iVol, &updated);
+    } else {
+        update(Q, R, dt, iVol, &updated);
+    }
+    return monitor.getLast();
+}
+
+const ResidualNorms &Solver::recordTileSums(const ResidualNorms *sums, std::size_t tiles, double nCells) {
+    // added in tile order, the same for any thread count
+    ResidualNorms norms;
+    for (std::size_t t = 0; t < tiles; ++t) {
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            norms.L2[k] += sums[t].L2[k];
+            norms.Linf[k] = std::max(norms.Linf[k], sums[t].Linf[k]);
+        }
+    }
+    for (int k = 0; k < FlowState::NVAR; ++k) {
+        norms.L2[k] = std::sqrt(norms.L2[k] / nCells);
+    }
+    return monitor.record(norms);
+}
+
+template <typename Real>
+void Solver::update(BasicFlowState<Real> &Q, const BasicFlowState<Real> &R,
+                    const AlignedVector<Real> &dtField, const AlignedVector<Real> &iVol,
+                    const std::vector<unsigned char> *active) {
+    const int stride = Q.getStride();
+    const TileDecomposition &tiles = flux.getTiles();
+
+    // forward Euler: Q -= dt / V * R, formed in double before rounding to storage
+    parallelFor(0, tiles.getTileCount(), [&](int t) {
+        if (active && !(*active)[t]) {
+            return;
+        }
+        const Tile &tile = tiles.getTile(t);
+        for (int k = 0; k < FlowState::NVAR; ++k) {
+            for (int j = tile.jBegin; j < tile.jEnd; ++j) {
+                const Real *Rk = R.row(k, j);
+                const Real *dtRow = dtField.data() + static_cast<std::size_t>(j) * stride;
+                const Real *iv = iVol.data() + static_cast<std::size_t>(j) * stride;
+                Real *Qk = Q.row(k, j);
+                for (int i = tile.iBegin; i < tile.iEnd; ++i) {
+                    Qk[i] = static_cast<Real>(Qk[i] - static_cast<double>(dtRow[i]) * iv[i] * Rk[i]);
+                }
+            }
+        }
+    });
+}
+
+void Solver::syncState() {
+    if (single) {
+        init.getState().copyFrom(single->Q);
+    }
+}
+
+bool Solver::run() {
+    // checkpoints and solution files go to disk on background threads
+    std::unique_ptr<CheckpointWriter> checkpoint;
+    if (options.checkpointInterval > 0) {
+        checkpoint = std::make_unique<CheckpointWriter>(grid, options.checkpointFile, init.getGamma());
+    }
+    std::unique_ptr<SolutionWriter> output;
+    if (options.output.enabled) {
+        output = std::make_unique<SolutionWriter>(grid, init.getR(), init.getGamma(), options.output);
+    }
+    auto finalOutput = [&]() {
+        if (!options.profile.report.empty()) {
+            Profiler::writeReport(options.profile.report);
+        }
+        if (checkpoint) {
+            checkpoint->submit(init.getState(), monitor.getIterations(), monitor.getHistory());
+        }
+        if (output) {
+            output->submit(init.getState(), monitor.getIterations());
+        }
+        if (checkpoint) {
+            checkpoint->wait();
+        }
+        if (output) {
+            output->wait();
+        }
+    };
+
+    // a fused sweep may take several steps per iterate()
+    for (int n = monitor.getIterations(); n < options.maxIterations; n = monitor.getIterations()) {
+        const ResidualNorms &norms = iterate();
+        Profiler::countIteration();
+        const int done = monitor.getIterations();
+
+        if (due(n, done, options.printInterval)) {
+            std::cout << "iter " << std::setw(6) << n
+                      << std::scientific << std::setprecision(4)
+                      << "  L2(rho) " << norms.L2[0]
+                      << "  Linf(rho) " << norms.Linf[0]
+                      << "  rel " << monitor.relativeL2()
+                      << std::defaultfloat;
+            if (options.freezeSettled) {
+                std::cout << "  active " << std::lround(100.0 * activeFraction) << "%";
+            }
+            std::cout << "\n";
+        }
+        if (Profiler::enabled() && due(n, done, options.profile.interval)) {
+            Profiler::printLine(std::cout, n);
+        }
+        if (monitor.converged()) {
+            syncState();
+            init.applyBoundaryConditions();
+            finalOutput();
+            std::cout << "Converged after " << monitor.getIterations() << " iterations\n";
+            return true;
+        }
+        if (monitor.diverged()) {
+            std::cerr << "Residual diverged after " << monitor.getIterations() << " iterations\n";
+            if (!options.profile.report.empty()) {
+                Profiler::writeReport(options.profile.report);
+            }
+            return false;
+        }
+        if (monitor.stalled()) {
+            syncState();
+            init.applyBoundaryConditions();
+            finalOutput();
+            std::cout << "Residual stalled after " << monitor.getIterations() << " iterations\n";
+            return false;
+        }
+        const bool checkpointDue = checkpoint && due(n + 1, done + 1, options.checkpointInterval);
+        const bool outputDue = output && due(n + 1, done + 1, options.output.interval);
+        if (checkpointDue || outputDue) {
+            // a fused sweep leaves the ghosts of the swapped-in state stale
+            syncState();
+            init.applyBoundaryConditions();
+        }
+        if (checkpointDue) {
+            checkpoint->submit(init.getState(), monitor.getIterations(), monitor.getHistory());
+        }
+        if (outputDue) {
+            output->submit(init.getState(), monitor.getIterations());
+        }
+    }
+    syncState();
+    init.applyBoundaryConditions();
+    finalOutput();
+    std::cout << "Reached " << options.maxIterations << " iterations without converging\n";
+    return false;
+}
+
+bool Solver::restart(const std::string &filename) {
+    CheckpointInfo info;
+    if (!readCheckpoint(filename, grid, init.getState(), info)) {
+        return false;
+    }
+    if (info.sameGrid) {
+        monitor.restore(info.history);
+    } else if (!info.history.empty()) {
+        // warm start on another grid: keep judging convergence against the
+        // cold start of the run that wrote the checkpoint
+        monitor.setReference(info.history.front());
+    }
+    init.applyBoundaryConditions();
+    if (single) {
+        single->Q.copyFrom(init.getState());
+    }
+    updated.clear(); // every tile is re-evaluated
+    return true;
+}
+
+bool Solver::warmStart(const FlowState &Q0) {
+    FlowState &Q = init.getState();
+    if (Q0.getNI() != Q.getNI() || Q0.getNJ() != Q.getNJ()) {
+        std::cerr << "Warm start state is " << Q0.getNI() << " x " << Q0.getNJ()
+                  << " cells, grid has " << Q.getNI() << " x " << Q.getNJ() << "\n";
+        return false;
+    }
+
+    // residual of the initial conditions, the cold start this replaces
+    monitor.reset();
+    const ResidualNorms reference = monitor.record(evaluateResidual());
+    monitor.reset();
+    monitor.setReference(reference);
+
+    Q.copyFrom(Q0);
+    init.applyBoundaryConditions();
+    if (single) {
+        single->Q.copyFrom(Q);
+    }
+    updated.clear(); // every tile is re-evaluated
+    return true;
+}
@@ -0,0 +1,341 @@
+#include "Sweep.h"
+#include "GridGenerator.h"
+#include "Initialize.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// base_name.ext for a per-case file
+std::string caseFile(const std::string &base, const std::string &name) {
+    std::filesystem::path p(base);
+    p.replace_filename(p.stem().string() + "_" + name + p.extension().string());
+    return p.string();
+}
+
+// Q0 rescaled from the inlet state Qfrom to Qto: density, velocity and
+// pressure each by their inlet ratio
+void rescaleState(const FlowState &Q0, const std::array<double, 4> &Qfrom,
+                  const std::array<double, 4> &Qto, double gamma, FlowState &Q) {
+    auto primitives = [&](const std::array<double, 4> &q, double &rho, double &V, double &P) {
+        rho = q[0];
+        V = std::hypot(q[1], q[2]) / q[0];
+        P = (gamma - 1.0) * (q[3] - 0.5 * rho * V * V);
+    };
+    double rhoFrom, VFrom, PFrom, rhoTo, VTo, PTo;
+    primitives(Qfrom, rhoFrom, VFrom, PFrom);
+    primitives(Qto, rhoTo, VTo, PTo);
+    const double sRho = rhoTo / rhoFrom;
+    const double sV = VTo / VFrom;
+    const double sP = PTo / PFrom;
+
+    parallelFor(0, Q.getNJ(), [&](int j) {
+        const double *rho0 = Q0.row(0, j), *rhoU0 = Q0.row(1, j), *rhoV0 = Q0.row(2, j), *E0 = Q0.row(3, j);
+        double *rho = Q.row(0, j), *rhoU = Q.row(1, j), *rhoV = Q.row(2, j), *E = Q.row(3, j);
+        for (int i = 0; i < Q.getNI(); ++i) {
+            const double u = rhoU0[i] / rho0[i];
+            const double v = rhoV0[i] / rho0[i];
+            const double P = (gamma - 1.0) * (E0[i] - 0.5 * rho0[i] * (u * u + v * v));
+            rho[i] = rho0[i] * sRho;
+            rhoU[i] = rho[i] * u * sV;
+            rhoV[i] = rho[i] * v * sV;
+            E[i] = P * sP / (gamma - 1.0) + 0.5 * rho[i] * (u * u + v * v) * sV * sV;
+        }
+    });
+}
+
+} // namespace
+
+bool readCaseList(const std::string &filename, std::vector<SweepCase> &cases) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open case list: " << filename << "\n";
+        return false;
+    }
+
+    cases.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        SweepCase c;
+        if (!(fields >> c.name)) {
+            continue; // blank or comment
+        }
+        if (!(fields >> c.grid >> c.P >> c.T >> c.M) || c.P <= 0.0 || c.T <= 0.0 || c.M <= 0.0) {
+            std::cerr << filename << ":" << lineNumber << ": expected name grid P T M\n";
+            return false;
+        }
+        cases.push_back(c);
+    }
+    if (cases.empty()) {
+        std::cerr << "No cases in " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+Sweep::Sweep(double R_, double gamma_, double Cp_,
+             const SolverOptions &solverOptions_,
+             const SweepOptions &options_)
+  : R(R_), gamma(gamma_), Cp(Cp_), solverOptions(solverOptions_), options(options_)
+{
+    // cases report one line each; the profile covers the whole sweep
+    solverOptions.printInterval = 0;
+    solverOptions.profile = ProfileOptions();
+    options.workers = std::max(options.workers, 1);
+    options.threadsPerCase = std::max(options.threadsPerCase, 1);
+}
+
+bool Sweep::loadGrids(const std::vector<SweepCase> &list) {
+    grids.clear();
+    gridOf.assign(list.size(), -1);
+    for (std::size_t n = 0; n < list.size(); ++n) {
+        auto found = std::find_if(grids.begin(), grids.end(),
+                                  [&](const auto &g) { return g->file == list[n].grid; });
+        if (found != grids.end()) {
+            gridOf[n] = static_cast<int>(found - grids.begin());
+            continue;
+        }
+
+        auto shared = std::make_unique<SharedGrid>();
+        shared->file = list[n].grid;
+        if (isGridSpec(shared->file)) {
+            GridSpec spec;
+            if (!parseGridSpec(shared->file, spec) || !generateGrid(spec, shared->grid)) {
+                return false;
+            }
+            shared->grid.computeCellMetrics();
+        } else {
+            const std::string cache = std::filesystem::path(shared->file).replace_extension(".grid").string();
+            if (!shared->grid.loadGrid(shared->file, cache)) {
+                return false;
+            }
+        }
+        if (options.useMultigrid) {
+            shared->coarse = Multigrid::agglomerateLevels(shared->grid, options.multigrid);
+        }
+        gridOf[n] = static_cast<int>(grids.size());
+        grids.push_back(std::move(shared));
+    }
+    return true;
+}
+
+const Sweep::Solution *Sweep::nearestSolution(int index) const {
+    const SweepCase &c = cases[index];
+    const Solution *nearest = nullptr;
+    double best = options.warmStartRadius;
+    for (const Solution &s : solutions) {
+        if (gridOf[s.index] != gridOf[index]) {
+            continue;
+        }
+        const double d = std::fabs(c.M - cases[s.index].M) / cases[s.index].M;
+        if (d <= best) {
+            best = d;
+            nearest = &s;
+        }
+    }
+    return nearest;
+}
+
+bool Sweep::attempt(const SweepCase &c, const SharedGrid &shared, Initialize &init,
+                    const FlowState *Q0, SweepResult &result) const {
+    SolverOptions caseOptions = solverOptions;
+    caseOptions.checkpointFile = caseFile(solverOptions.checkpointFile, c.name);
+    caseOptions.output.prefix = solverOptions.output.prefix + "_" + c.name;
+
+    init.setInitialConditions(c.P, c.T, c.M);
+    init.applyBoundaryConditions();
+
+    bool converged = false;
+    if (options.useMultigrid) {
+        Multigrid multigrid(shared.grid, init, caseOptions, options.multigrid, &shared.coarse);
+        if (Q0 && !multigrid.warmStart(*Q0)) {
+            return false;
+        }
+        converged = multigrid.run();
+        result.iterations = multigrid.getMonitor().getIterations();
+        result.relativeL2 = multigrid.getMonitor().relativeL2();
+    } else {
+        Solver solver(shared.grid, init, caseOptions);
+        if (Q0 && !solver.warmStart(*Q0)) {
+            return false;
+        }
+        converged = solver.run();
+        result.iterations = solver.getMonitor().getIterations();
+        result.relativeL2 = solver.getMonitor().relativeL2();
+    }
+    return converged;
+}
+
+void Sweep::solveCase(int index) {
+    const SweepCase &c = cases[index];
+    const SharedGrid &shared = *grids[gridOf[index]];
+    SweepResult &result = results[index];
+    result.name = c.name;
+    const auto start = std::chrono::steady_clock::now();
+
+    // the neighbour's state stays alive through the shared_ptr
+    std::shared_ptr<const FlowState> neighbour;
+    int from = -1;
+    if (options.warmStart) {
+        std::lock_guard<std::mutex> lock(solutionsMutex);
+        if (const Solution *s = nearestSolution(index)) {
+            neighbour = s->Q;
+            from = s->index;
+        }
+    }
+
+    Initialize init(shared.grid, R, gamma, Cp);
+    FlowState Q0;
+    if (neighbour) {
+        // inlet states of both cases, from the initial conditions
+        init.setInitialConditions(cases[from].P, cases[from].T, cases[from].M);
+        const std::array<double, 4> Qfrom = init.getFreestream();
+        init.setInitialConditions(c.P, c.T, c.M);
+        Q0.resize(neighbour->getNI(), neighbour->getNJ());
+        rescaleState(*neighbour, Qfrom, init.getFreestream(), gamma, Q0);
+        result.warmStart = cases[from].name;
+    }
+
+    result.converged = attempt(c, shared, init, neighbour ? &Q0 : nullptr, result);
+    if (!result.converged && neighbour) {
+        // a neighbour too far away can fail where the freestream would not
+        result.warmStart.clear();
+        result.converged = attempt(c, shared, init, nullptr, result);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (result.converged) {
+        auto Q = std::make_shared<FlowState>();
+        Q->resize(init.getState().getNI(), init.getState().getNJ());
+        Q->copyFrom(init.getState());
+        std::lock_guard<std::mutex> lock(solutionsMutex);
+        solutions.push_back(Solution{index, std::move(Q)});
+    }
+
+    std::lock_guard<std::mutex> lock(printMutex);
+    std::cout << "case " << std::setw(12) << std::left << c.name << std::right
+              << (result.converged ? "  converged " : "  FAILED    ")
+              << std::setw(6) << result.iterations
+              << std::scientific << std::setprecision(3) << "  rel " << result.relativeL2
+              << std::fixed << std::setprecision(2) << "  " << result.seconds << " s"
+              << std::defaultfloat << std::setprecision(6)
+              << (result.warmStart.empty() ? "  cold" : "  from " + result.warmStart) << "\n";
+}
+
+bool Sweep::run(const std::vector<SweepCase> &list) {
+    cases = list;
+    results.assign(cases.size(), SweepResult());
+    solutions.clear();
+    if (!loadGrids(cases)) {
+        return false;
+    }
+
+    // neighbouring inlet states next to each other, cut into one run per worker
+    std::vector<int> order(cases.size());
+    for (std::size_t n = 0; n < order.size(); ++n) {
+        order[n] = static_cast<int>(n);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        const SweepCase &ca = cases[a];
+        const SweepCase &cb = cases[b];
+        if (gridOf[a] != gridOf[b]) return gridOf[a] < gridOf[b];
+        if (ca.M != cb.M) return ca.M < cb.M;
+        if (ca.P != cb.P) return ca.P < cb.P;
+        return ca.T < cb.T;
+    });
+
+    const int workers = std::min(options.workers, static_cast<int>(cases.size()));
+    std::vector<std::deque<int>> queues(workers);
+    std::vector<std::mutex> queueMutex(workers);
+    for (std::size_t n = 0; n < order.size(); ++n) {
+        queues[n * workers / order.size()].push_back(order[n]);
+    }
+
+    // own run from the front; otherwise the back of the longest other run
+    auto next = [&](int w) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex[w]);
+            if (!queues[w].empty()) {
+                const int index = queues[w].front();
+                queues[w].pop_front();
+                return index;
+            }
+        }
+        for (;;) {
+            int victim = -1;
+            std::size_t longest = 0;
+            for (int v = 0; v < workers; ++v) {
+                std::lock_guard<std::mutex> lock(queueMutex[v]);
+                if (queues[v].size() > longest) {
+                    longest = queues[v].size();
+                    victim = v;
+                }
+            }
+            if (victim < 0) {
+                return -1;
+            }
+            std::lock_guard<std::mutex> lock(queueMutex[victim]);
+            if (!queues[victim].empty()) {
+                const int index = queues[victim].back();
+                queues[victim].pop_back();
+                return index;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    for (int w = 0; w < workers; ++w) {
+        pool.emplace_back([&, w]() {
+            setThreadCount(options.threadsPerCase);
+            for (int index = next(w); index >= 0; index = next(w)) {
+                solveCase(index);
+            }
+        });
+    }
+    for (std::thread &t : pool) {
+        t.join();
+    }
+
+    bool all = std::all_of(results.begin(), results.end(), [](const SweepResult &r) { return r.converged; });
+    if (!options.summary.empty() && !writeSummary()) {
+        all = false;
+    }
+    return all;
+}
+
+bool Sweep::writeSummary() const {
+    std::ofstream out(options.summary, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open sweep summary: " << options.summary << "\n";
+        return false;
+    }
+    out << std::setprecision(9);
+    out << "name,grid,P,T,M,converged,iterations,seconds,relative_l2,warm_start\n";
+    for (std::size_t n = 0; n < cases.size(); ++n) {
+        const SweepCase &c = cases[n];
+        const SweepResult &r = results[n];
+        out << c.name << "," << c.grid << "," << c.P << "," << c.T << "," << c.M << ","
+            << (r.converged ? 1 : 0) << "," << r.iterations << "," << r.seconds << ","
+            << r.relativeL2 << "," << r.warmStart << "\n";
+    }
+    if (!out) {
+        std::cerr << "Failed to write sweep summary: " << options.summary << "\n";
+        return false;
+    }
+    return true;
+}
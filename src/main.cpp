@@ -1,11 +1,26 @@
 #include "GridHandler.h"
+#include "GridGenerator.h"
 #include "Initialize.h"
+#include "Solver.h"
+#include "Multigrid.h"
+#include "AdaptiveMesh.h"
+#include "Sweep.h"
 #include <matplot/matplot.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#if defined(EULER_MPI)
+#include "MultiBlock.h"
+#endif
 
 using namespace matplot;
 
 
-int main() {
+int main(int argc, char **argv) {
     // Thermodynamic and Transport Properties
     const double R = 287.0; // [J / kg*K] gas constant
     const double Cp = 1005.0; // [J / kg*K] specific heat
@@ -18,54 +33,220 @@ int main() {
     double M_i = 3.000; // inlet Mach Number
 
     GridHandler grid;
-    Initialize init(grid, R, gamma, Cp);
-
-    // Read in grid file
-    if (!grid.readGridFile("data\\g641x065uf.dat")) {
-        return 1;
+    const std::string gridFile = "data/g641x065uf.dat";
+    const std::string cacheFile = "data/g641x065uf.grid"; // binary nodes + metrics
+
+    // Pseudo-time march to steady state with local CFL time stepping
+    SolverOptions options;
+    options.cfl = 0.8;
+    options.localTimeStep = true;
+    options.tolerance = 1e-8;
+    options.fusedSweep = true; // BCs, fluxes, dt and update in one cache-blocked pass
+    options.checkpointFile = "data/g641x065uf.ckpt";
+
+    // VTK and Tecplot solution files, written on a background thread
+    options.output.enabled = true;
+    options.output.vtk = true;
+    options.output.tecplot = true;
+    options.output.prefix = "data/solution";
+
+    // Phase timers from the grid read on, data/profile.json/.csv at the end
+    Profiler::setEnabled(true);
+    Profiler::reset();
+    options.profile.report = "data/profile";
+
+    // adaptive refinement around the shocks and fans: Inviscid_Euler_Solver
+    // --adaptive [ratio] ahead of the other arguments, e.g. --adaptive 4
+    // --grid wedge:ni=321,nj=33 (fine cells per base cell, default 4)
+    bool useAdaptive = false;
+    AdaptiveOptions amrOptions;
+    amrOptions.ratio = 4;
+    int first = 1; // first argument after --adaptive [ratio]
+    if (argc > 1 && std::string(argv[1]) == "--adaptive") {
+        useAdaptive = true;
+        first = 2;
+        if (argc > 2 && std::isdigit(static_cast<unsigned char>(argv[2][0]))) {
+            amrOptions.ratio = std::atoi(argv[2]);
+            first = 3;
+        }
     }
 
-    // Compute Cell Metrics
-    grid.computeCellMetrics();
-
-    // Apply free stream conditions
-    init.setInitialConditions(P_i, T_i, M_i);
-
-
-
-
-
-    /* Psuedo Code...
-
-        temporal loop
-        for ... defined using CFL number
-
-            for .... (sweep entire mesh) construct fluxes
-
-            end
-
-            for .... (sweep entire mesh) difference fluxes
-
-            end
-
-            if .... (convergence criteria is met)
-                break loop, YAY solver worked
-            else
-                continue
-            end
-
-        end
-    
-    */
-
-
-
-
+    // grid export: Inviscid_Euler_Solver --write-grid <spec> <file> writes a
+    // generated grid as text (like data/*.dat) or, for a .grid file, as the
+    // binary cache with its metrics
+    if (argc > first + 2 && std::string(argv[first]) == "--write-grid") {
+        GridSpec spec;
+        if (!parseGridSpec(argv[first + 1], spec) || !generateGrid(spec, grid)) {
+            return 1;
+        }
+        const std::string out = argv[first + 2];
+        if (std::filesystem::path(out).extension() == ".grid") {
+            grid.computeCellMetrics();
+            return grid.writeCache(out) ? 0 : 1;
+        }
+        return grid.writeGridFile(out) ? 0 : 1;
+    }
 
+    // generated grid instead of the grid file: Inviscid_Euler_Solver --grid
+    // <spec> [checkpoint], e.g. --grid wedge:ni=1281,nj=129,angle=10
+    GridSpec gridSpec;
+    const bool generated = argc > first + 1 && std::string(argv[first]) == "--grid";
+    if (generated) {
+        if (!parseGridSpec(argv[first + 1], gridSpec)) {
+            return 1;
+        }
+        options.checkpointFile = "data/generated.ckpt";
+    }
 
+#if defined(EULER_MPI)
+    // under mpirun -np N (N > 1) every rank solves one block of the grid
+    int provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int ranks = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    if (ranks > 1) {
+        // only rank 0 loads the grid; it sends every rank its block and
+        // gathers the blocks back for the solution files
+        int rank = 0;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        int loaded = 1;
+        if (rank == 0) {
+            if (generated) {
+                loaded = generateGrid(gridSpec, grid);
+                if (loaded) {
+                    grid.computeCellMetrics();
+                }
+            } else {
+                loaded = grid.loadGrid(gridFile, cacheFile);
+            }
+        }
+        MPI_Bcast(&loaded, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (useAdaptive && rank == 0) {
+            std::cerr << "Adaptive refinement runs in a single process, solving the blocks unrefined\n";
+        }
+        if (!loaded) {
+            MPI_Finalize();
+            return 1;
+        }
+        bool converged = false;
+        bool written = true;
+        {
+            MultiBlock blocks(grid, R, gamma, Cp);
+            blocks.setInitialConditions(P_i, T_i, M_i);
+            options.printInterval = 200;
+            converged = blocks.run(options);
+
+            std::unique_ptr<Initialize> global;
+            if (rank == 0) {
+                global = std::make_unique<Initialize>(grid, R, gamma, Cp);
+            }
+            blocks.gather(global.get());
+            if (rank == 0 && options.output.enabled) {
+                SolutionWriter writer(grid, R, gamma, options.output);
+                writer.submit(global->getState(), blocks.getIterations());
+                written = writer.wait();
+            }
+        }
+        MPI_Finalize();
+        return !written ? 1 : (converged ? 0 : 2);
+    }
+#endif
+
+    // batch mode: Inviscid_Euler_Solver --sweep <case list> [workers]
+    if (argc > first + 1 && std::string(argv[first]) == "--sweep") {
+        if (useAdaptive) {
+            std::cerr << "Adaptive refinement is not available in a sweep, solving the cases unrefined\n";
+        }
+        std::vector<SweepCase> cases;
+        bool converged = false;
+        if (readCaseList(argv[first + 1], cases)) {
+            SweepOptions sweepOptions;
+            sweepOptions.workers = argc > first + 2 ? std::max(std::atoi(argv[first + 2]), 1) : 1;
+            sweepOptions.multigrid.levels = 4;
+            sweepOptions.multigrid.cycleIndex = 2; // W-cycle
+            sweepOptions.summary = "data/sweep_results.csv";
+            options.output.prefix = "data/sweep";
+            options.profile.report.clear();
+
+            Sweep sweep(R, gamma, Cp, options, sweepOptions);
+            converged = sweep.run(cases);
+        }
+#if defined(EULER_MPI)
+        MPI_Finalize();
+#endif
+        return cases.empty() ? 1 : (converged ? 0 : 2);
+    }
 
+    // optional restart: Inviscid_Euler_Solver <checkpoint> (same or refined grid)
+    const int restartArg = generated ? first + 2 : first;
+    const std::string restartFile = argc > restartArg ? argv[restartArg] : "";
+
+    // Read in grid file and compute cell metrics, or load both from the cache
+    // (a generated grid is built in memory)
+    bool loaded;
+    if (generated) {
+        loaded = generateGrid(gridSpec, grid);
+        if (loaded) {
+            grid.computeCellMetrics();
+        }
+    } else {
+        loaded = grid.loadGrid(gridFile, cacheFile);
+    }
+    if (!loaded) {
+#if defined(EULER_MPI)
+        MPI_Finalize();
+#endif
+        return 1;
+    }
 
+    // State is sized from the halo-extended grid
+    Initialize init(grid, R, gamma, Cp);
 
+    // Apply free stream conditions
+    init.setInitialConditions(P_i, T_i, M_i);
+    init.applyBoundaryConditions();
+
+    // FAS multigrid on agglomerated coarse levels (false = single grid),
+    // unless --adaptive refines the single grid instead
+    const bool useMultigrid = true;
+
+    bool restored = true;
+    bool converged = false;
+    if (useAdaptive) {
+        options.printInterval = 20;
+        options.output.interval = 1000;
+        options.profile.interval = 1000;
+        options.checkpointInterval = 500; // iterations
+
+        // checkpoints hold the base level (patch averages under the patches);
+        // a restart rebuilds the patches from it by interpolation
+        AdaptiveMesh amr(grid, init, options, amrOptions);
+        restored = restartFile.empty() || amr.restart(restartFile);
+        converged = restored && amr.run();
+    } else if (useMultigrid) {
+        MultigridOptions mgOptions;
+        mgOptions.levels = 4;
+        mgOptions.cycleIndex = 2; // W-cycle
+        options.printInterval = 20;
+        options.checkpointInterval = 50; // cycles
+        options.output.interval = 100;
+        options.profile.interval = 100;
+
+        Multigrid multigrid(grid, init, options, mgOptions);
+        restored = restartFile.empty() || multigrid.restart(restartFile);
+        converged = restored && multigrid.run();
+    } else {
+        options.checkpointInterval = 500; // iterations
+        options.output.interval = 1000;
+        options.profile.interval = 1000;
+
+        Solver solver(grid, init, options);
+        restored = restartFile.empty() || solver.restart(restartFile);
+        converged = restored && solver.run();
+    }
 
-    return 0;
+#if defined(EULER_MPI)
+    MPI_Finalize();
+#endif
+    return !restored ? 1 : (converged ? 0 : 2);
 }
\ No newline at end of file